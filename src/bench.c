@@ -0,0 +1,899 @@
+/*
+ * Demolito, a UCI chess engine. Copyright 2015-2020 lucasart.
+ *
+ * Demolito is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * Demolito is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program. If
+ * not, see <http://www.gnu.org/licenses/>.
+*/
+#ifdef __linux__
+    #define _GNU_SOURCE  // sched_setaffinity()
+    #include <poll.h>
+    #include <sched.h>
+    #include <signal.h>
+    #include <sys/wait.h>
+#endif
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+#include "bitboard.h"
+#include "eval.h"
+#include "gen.h"
+#include "htable.h"
+#include "perf.h"
+#include "platform.h"
+#include "position.h"
+#include "search.h"
+#include "stats.h"
+#include "uci.h"
+#include "util.h"
+#include "workers.h"
+
+static const char *BenchFens[] = {
+    #include "test.csv"
+    NULL
+};
+
+// Search all bench positions to the given depth. Returns the number of nodes, and updates seal.
+static uint64_t bench_suite(int depth, uint64_t *seal)
+{
+    uint64_t nodes = 0;
+    uciChess960 = true;
+
+    lim = (Limits){0};
+    lim.depth = depth;
+
+    for (int i = 0; BenchFens[i]; i++) {
+        pos_set(&rootPos, BenchFens[i]);
+        zobrist_clear(&rootStack);
+        zobrist_push(&rootStack, rootPos.key);
+
+        if (!uciQuiet)
+            puts(BenchFens[i]);
+
+        nodes += search_go();
+        *seal = hash(&nodes, sizeof nodes, *seal);
+
+        if (!uciQuiet)
+            puts("");
+    }
+
+    return nodes;
+}
+
+void bench(int depth)
+{
+    uint64_t seal = 0;
+
+    stats_clear();
+
+    PerfCounters pc;
+    perf_open(&pc);
+    perf_start(&pc);
+    int64_t start = system_msec();
+
+    const uint64_t nodes = bench_suite(depth, &seal);
+
+    if (dbgCnt[0] || dbgCnt[1])
+        printf("dbgCnt[0] = %" PRId64 ", dbgCnt[1] = %" PRId64 "\n", dbgCnt[0], dbgCnt[1]);
+
+    const int64_t elapsed = system_msec() - start;
+    perf_stop(&pc);
+
+    seal = hash(HashTable, HashCount * sizeof(HashEntry), seal);  // sign entire hash table
+
+    printf("seal  : %" PRIx64 "\n", seal);  // strong functionality signature
+    printf("time  : %" PRIu64 "ms\n", elapsed);
+    printf("nodes : %" PRIu64 "\n", nodes);  // total nodes = weak functionality signature
+    printf("nps   : %.0f\n", nodes * 1000.0 / max(elapsed, 1));  // avoid div/0
+
+    perf_print(&pc, nodes);
+    perf_close(&pc);
+
+    stats_print();
+}
+
+// Run the bench at 1, 2, 4, ..., maxThreads threads. Each thread count is repeated several times,
+// from a cleared state (hash, workers), because SMP search is not deterministic. Time is the total
+// time to reach 'depth' on all positions, so ttd-x measures the time-to-depth speedup.
+void bench_scaling(int depth, int maxThreads, int runs)
+{
+    double time1 = 0, nodes1 = 0;
+    uciQuiet = true;
+
+    puts("threads  time(ms)   stdev       nodes       nps  nps-x  ttd-x  nodes-x  nps/thread");
+
+    for (int threads = 1; ; threads = min(2 * threads, maxThreads)) {
+        double sumTime = 0, sumTime2 = 0, sumNodes = 0;
+
+        for (int run = 0; run < runs; run++) {
+            uint64_t seal = 0;
+            workers_prepare((size_t)threads);
+            hash_prepare(uciHash);
+
+            const int64_t start = system_msec();
+            sumNodes += bench_suite(depth, &seal);
+            const double elapsed = max(system_msec() - start, (int64_t)1);
+
+            sumTime += elapsed;
+            sumTime2 += elapsed * elapsed;
+        }
+
+        const double time = sumTime / runs, nodes = sumNodes / runs;
+        const double stdev = sqrt(max(sumTime2 / runs - time * time, 0.0));
+
+        if (threads == 1) {
+            time1 = time;
+            nodes1 = nodes;
+        }
+
+        const double nps = nodes * 1000 / time, nps1 = nodes1 * 1000 / time1;
+        printf("%7d %9.0f %7.0f %11.0f %9.0f %6.2f %6.2f %8.3f %11.0f\n", threads, time, stdev,
+            nodes, nps, nps / nps1, time1 / time, nodes / nodes1, nps / threads);
+
+        if (threads >= maxThreads)
+            break;
+    }
+
+    uciQuiet = false;
+}
+
+#ifdef __linux__
+// Run 'procs' single threaded bench processes concurrently, each with its own workers and hash
+// table of 'hashMB'. Returns aggregate NPS (total nodes / wall time of the whole batch).
+static double throughput_batch(int depth, int procs, size_t hashMB)
+{
+    int (*fd)[2] = malloc((size_t)procs * sizeof(*fd));
+    pid_t *pid = malloc((size_t)procs * sizeof(*pid));
+
+    if (!fd || !pid) {
+        perror("throughput");
+        exit(EXIT_FAILURE);
+    }
+
+    fflush(stdout);  // otherwise children would flush a copy of our buffered output
+    const int64_t start = system_msec();
+
+    for (int i = 0; i < procs; i++) {
+        if (pipe(fd[i]) || (pid[i] = fork()) < 0) {
+            perror("throughput");
+            exit(EXIT_FAILURE);
+        }
+
+        if (!pid[i]) {
+            // Pin each process to its own CPU, like a farm would do
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET((size_t)(i % cpu_count()), &cpus);
+            sched_setaffinity(0, sizeof cpus, &cpus);
+
+            uciQuiet = true;
+            workers_prepare(1);
+            hash_prepare(hashMB);
+
+            uint64_t seal = 0;
+            const uint64_t nodes = bench_suite(depth, &seal);
+
+            close(fd[i][0]);
+            _exit(write(fd[i][1], &nodes, sizeof nodes) == sizeof nodes ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+
+        close(fd[i][1]);
+    }
+
+    uint64_t total = 0;
+
+    for (int i = 0; i < procs; i++) {
+        uint64_t nodes;
+
+        if (read(fd[i][0], &nodes, sizeof nodes) == sizeof nodes)
+            total += nodes;
+
+        close(fd[i][0]);
+        waitpid(pid[i], NULL, 0);
+    }
+
+    free(fd);
+    free(pid);
+    return total * 1000.0 / max(system_msec() - start, (int64_t)1);
+}
+
+// Aggregate throughput, when running one single threaded search per core (datagen and analysis
+// farms), rather than one SMP search. Each process uses a 'hashMB / procs' slice of hash. The
+// degradation is the loss of NPS per process compared to running alone, due to shared LLC and
+// memory bandwidth.
+void bench_throughput(int depth, int procs, size_t hashMB)
+{
+    // bb_msb(0) is undefined: at least 1MB per process
+    const size_t slice = (size_t)1 << bb_msb(max(hashMB / (size_t)procs, (size_t)1));
+    printf("procs: %d, hash: %zuMB per process\n", procs, slice);
+
+    const double solo = throughput_batch(depth, 1, slice);
+    const double total = throughput_batch(depth, procs, slice);
+
+    printf("solo nps      : %.0f\n", solo);
+    printf("aggregate nps : %.0f\n", total);
+    printf("nps/process   : %.0f\n", total / procs);
+    printf("degradation   : %.1f%%\n", 100 * (1 - total / procs / solo));
+}
+#else
+void bench_throughput(int depth, int procs, size_t hashMB)
+{
+    (void)depth, (void)procs, (void)hashMB;
+    puts("throughput: not supported on this platform");
+}
+#endif
+
+// Two-sided Student t quantiles (97.5%), by degrees of freedom
+static double student_t(int df)
+{
+    static const double t[] = {0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+        2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086, 2.080, 2.074,
+        2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+    return df < (int)(sizeof(t) / sizeof(t[0])) ? t[df] : 1.96;
+}
+
+// Run the bench of 'engine' (format "exe" or "exe:params", where params is a TUNE parameter file),
+// and parse its seal and nps. Returns false on failure.
+static bool compare_run(const char *engine, int depth, uint64_t *seal, double *nps)
+{
+    char exe[1024], cmd[2048], line[1024];
+    const char *params = strchr(engine, ':');
+
+    snprintf(exe, sizeof exe, "%.*s", params ? (int)(params - engine) : (int)strlen(engine), engine);
+    snprintf(cmd, sizeof cmd, "%s bench %d 1 %zu %s", exe, depth, uciHash, params ? params + 1 : "");
+
+    FILE *out = popen(cmd, "r");
+
+    if (!out)
+        return false;
+
+    *nps = 0;
+
+    while (fgets(line, sizeof line, out))
+        if (!sscanf(line, "seal  : %" SCNx64, seal))
+            sscanf(line, "nps   : %lf", nps);
+
+    return !pclose(out) && *nps > 0;
+}
+
+// Compare the speed of two engines (or two TUNE parameter sets), interleaving their bench runs
+// (ABBA order, to cancel linear drift) on the same CPU. The NPS delta is estimated from the paired
+// NPS ratios, with a 95% confidence interval.
+void bench_compare(const char *engines[2], int runs, int depth)
+{
+#ifdef __linux__
+    // Pin ourselves, and therefore our children, to the same CPU
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET((size_t)(cpu_count() - 1), &cpus);
+    sched_setaffinity(0, sizeof cpus, &cpus);
+#endif
+
+    double sum = 0, sum2 = 0, sumNps[2] = {0, 0};
+    uint64_t seal[2] = {0, 0};
+    bool sameSeal = true;
+
+    for (int run = 0; run < runs; run++) {
+        double nps[2];
+
+        for (int i = 0; i < 2; i++) {
+            const int e = i ^ (run & 1);
+            uint64_t s = 0;
+
+            if (!compare_run(engines[e], depth, &s, &nps[e])) {
+                printf("compare: failed to run '%s'\n", engines[e]);
+                return;
+            }
+
+            sameSeal = sameSeal && (!run || s == seal[e]);
+            seal[e] = s;
+            sumNps[e] += nps[e];
+        }
+
+        const double ratio = nps[1] / nps[0] - 1;
+        sum += ratio;
+        sum2 += ratio * ratio;
+        printf("run %3d: A %.0f nps, B %.0f nps, B/A-1 = %+.2f%%\n", run + 1, nps[0], nps[1],
+            100 * ratio);
+    }
+
+    const double mean = sum / runs;
+    const double stdev = runs > 1 ? sqrt(max((sum2 - runs * mean * mean) / (runs - 1), 0.0)) : 0;
+    const double margin = runs > 1 ? student_t(runs - 1) * stdev / sqrt(runs) : INFINITY;
+
+    printf("seal A: %" PRIx64 "\nseal B: %" PRIx64 " (%s)\n", seal[0], seal[1],
+        seal[0] == seal[1] ? "equal" : "DIFFERENT: not a functional no-op");
+
+    if (!sameSeal)
+        puts("warning: seals vary across runs (SMP or non deterministic build?)");
+
+    printf("nps A : %.0f\nnps B : %.0f\n", sumNps[0] / runs, sumNps[1] / runs);
+    printf("delta : %+.2f%% +/- %.2f%% (95%% CI), %s\n", 100 * mean, 100 * margin,
+        mean - margin > 0 ? "B is faster" : mean + margin < 0 ? "B is slower"
+        : "no significant difference");
+}
+
+#ifdef __linux__
+// Engine process, driven over pipes (see bench_latency)
+typedef struct {
+    pid_t pid;
+    int in, out;  // engine's stdin (we write) and stdout (we read)
+    char buf[4096];
+    size_t len;
+} Engine;
+
+static bool engine_start(Engine *e, const char *exe)
+{
+    int toEngine[2], fromEngine[2];
+
+    if (pipe(toEngine) || pipe(fromEngine) || (e->pid = fork()) < 0)
+        return false;
+
+    if (!e->pid) {
+        dup2(toEngine[0], STDIN_FILENO);
+        dup2(fromEngine[1], STDOUT_FILENO);
+        close(toEngine[1]);
+        close(fromEngine[0]);
+        execl(exe, exe, (char *)NULL);
+        _exit(127);
+    }
+
+    close(toEngine[0]);
+    close(fromEngine[1]);
+    e->in = toEngine[1];
+    e->out = fromEngine[0];
+    e->len = 0;
+    return true;
+}
+
+// Returns the time (ns) at which the command was written
+static int64_t engine_send(Engine *e, const char *cmd)
+{
+    char line[256];
+    const int len = snprintf(line, sizeof line, "%s\n", cmd);
+    const int64_t t = system_nsec();
+
+    return write(e->in, line, (size_t)len) == len ? t : -1;
+}
+
+// Read lines until one starts with 'token'. Returns the time (ns) it was received, or -1 on timeout
+// or EOF (engine crashed, or did not answer within 'timeout' ms).
+static int64_t engine_wait(Engine *e, const char *token, int timeout)
+{
+    const size_t tokenLen = strlen(token);
+
+    for ( ; ; ) {
+        char *nl;
+
+        while ((nl = memchr(e->buf, '\n', e->len))) {
+            const bool found = (size_t)(nl - e->buf) >= tokenLen && !memcmp(e->buf, token, tokenLen);
+            e->len -= (size_t)(nl + 1 - e->buf);
+            memmove(e->buf, nl + 1, e->len);
+
+            if (found)
+                return system_nsec();
+        }
+
+        struct pollfd p = {.fd = e->out, .events = POLLIN};
+
+        if (e->len == sizeof e->buf)
+            e->len = 0;  // line too long: discard it
+
+        if (poll(&p, 1, timeout) <= 0)
+            return -1;
+
+        const ssize_t n = read(e->out, e->buf + e->len, sizeof e->buf - e->len);
+
+        if (n <= 0)
+            return -1;
+
+        e->len += (size_t)n;
+    }
+}
+
+static void print_percentiles(const char *label, int64_t *ns, int n)
+{
+    qsort(ns, (size_t)n, sizeof(int64_t), compare_int64);
+
+    static const double Quantiles[] = {0.5, 0.9, 0.99, 1};
+    printf("%-26s", label);
+
+    for (size_t i = 0; i < sizeof(Quantiles) / sizeof(*Quantiles); i++)
+        printf(" %9.3f", ns[min((int)(Quantiles[i] * n), n - 1)] / 1e6);
+
+    puts("");
+}
+
+// Measure the responsiveness of a UCI engine, driving it over pipes like a GUI would: uci -> uciok,
+// setoption Hash (resize) + isready -> readyok, go movetime -> bestmove (overshoot), and stop ->
+// bestmove. Lag here is lost on the clock, and is what the Time Buffer option must cover.
+void bench_latency(const char *exe, int rounds, int movetime, size_t hashMB)
+{
+    // If the engine dies, writing to its stdin must fail (EPIPE), rather than kill us
+    signal(SIGPIPE, SIG_IGN);
+
+    Engine e;
+    int64_t *uci = malloc(4 * (size_t)rounds * sizeof(int64_t));
+
+    if (!uci || !engine_start(&e, exe)) {
+        perror("latency");
+        free(uci);
+        return;
+    }
+
+    int64_t *hash = uci + rounds, *overshoot = hash + rounds, *stop = overshoot + rounds;
+    const size_t smallMB = max(hashMB / 4, (size_t)1);  // Hash 0 means automatic size
+    const int timeout = 10000 + movetime;
+    char cmd[64];
+    int n = 0;
+
+    for ( ; n < rounds; n++) {
+        const int64_t t0 = engine_send(&e, "uci");
+
+        if ((uci[n] = engine_wait(&e, "uciok", timeout) - t0) < 0)
+            break;
+
+        // Alternately grow and shrink the hash
+        snprintf(cmd, sizeof cmd, "setoption name Hash value %zu", n % 2 ? smallMB : hashMB);
+        const int64_t t1 = engine_send(&e, cmd);
+        engine_send(&e, "isready");
+
+        if ((hash[n] = engine_wait(&e, "readyok", timeout) - t1) < 0)
+            break;
+
+        engine_send(&e, "position startpos");
+        snprintf(cmd, sizeof cmd, "go movetime %d", movetime);
+        const int64_t t2 = engine_send(&e, cmd);
+
+        if ((overshoot[n] = engine_wait(&e, "bestmove", timeout) - t2 - movetime * 1000000LL)
+                < -movetime * 1000000LL)
+            break;
+
+        // Stop at various times (10 to 99 ms), to hit different phases of the timer loop
+        engine_send(&e, "go infinite");
+        const int delay = 10 + n * 37 % 90;
+        sleep_msec(delay);
+        const int64_t t3 = engine_send(&e, "stop");
+
+        if ((stop[n] = engine_wait(&e, "bestmove", timeout) - t3) < 0)
+            break;
+    }
+
+    engine_send(&e, "quit");
+    close(e.in);
+    close(e.out);
+    waitpid(e.pid, NULL, 0);
+
+    if (n < rounds)
+        printf("latency: engine '%s' did not answer (round %d)\n", exe, n + 1);
+    else {
+        printf("%d rounds, go movetime %d, Hash %zu <-> %zu MB\n", rounds, movetime, hashMB,
+            smallMB);
+        printf("%-26s %9s %9s %9s %9s (ms)\n", "", "p50", "p90", "p99", "max");
+        print_percentiles("uci -> uciok", uci, n);
+        print_percentiles("Hash + isready -> readyok", hash, n);
+        print_percentiles("go movetime: overshoot", overshoot, n);
+        print_percentiles("stop -> bestmove", stop, n);
+    }
+
+    free(uci);
+}
+#else
+void bench_latency(const char *exe, int rounds, int movetime, size_t hashMB)
+{
+    (void)exe, (void)rounds, (void)movetime, (void)hashMB;
+    puts("latency: not supported on this platform");
+}
+#endif
+
+// Perft suite: standard and Chess960 positions, with known leaf counts by depth
+enum {PERFT_MAX_DEPTH = 6};
+
+static const struct {
+    const char *fen;
+    uint64_t leaves[PERFT_MAX_DEPTH];  // leaves[d - 1] = perft(d), 0 if unknown
+} PerftSuite[] = {
+    {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        {20, 400, 8902, 197281, 4865609}},
+    {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        {48, 2039, 97862, 4085603}},
+    {"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        {14, 191, 2812, 43238, 674624, 11030083}},
+    {"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        {6, 264, 9467, 422333, 15833292}},
+    {"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        {44, 1486, 62379, 2103487}},
+    // Chess960
+    {"bqnb1rkr/pp3ppp/3ppn2/2p5/5P2/P2P4/NPP1P1PP/BQ1BNRKR w HFhf - 2 9",
+        {21, 528, 12189, 326672, 8146062}},
+    {"2nnrbkr/p1qppppp/8/1ppb4/6PP/3PP3/PPP2P2/BQNNRBKR w HEhe - 1 9",
+        {21, 807, 18002, 667366}},
+    {"b1q1rrkb/pppppppp/3nn3/8/P7/1PPP4/4PPPP/BQNNRKRB w GE - 1 9",
+        {20, 479, 10471, 273318, 6417013}},
+    {"qbbnnrkr/2pp2pp/p7/1p2pp2/8/P3PP2/1PPP1KPP/QBBNNR1R w hf - 0 9",
+        {22, 593, 13440, 382958, 9183776}},
+    {"1nbbnrkr/p1p1ppp1/3p4/1p3P1p/3Pq2P/8/PPP1P1P1/QNBBNRKR w HFhf - 0 9",
+        {28, 1120, 31058, 1171749}}
+};
+
+bool perft_suite(int maxDepth)
+{
+    const int count = sizeof(PerftSuite) / sizeof(PerftSuite[0]);
+    uint64_t nodes = 0;
+    int64_t elapsed = 0;
+    int passed = 0;
+
+    for (int i = 0; i < count; i++) {
+        Position pos;
+        pos_set(&pos, PerftSuite[i].fen);
+        puts(PerftSuite[i].fen);
+
+        bool ok = true;
+
+        for (int depth = 1; depth <= min(maxDepth, PERFT_MAX_DEPTH); depth++) {
+            const uint64_t expected = PerftSuite[i].leaves[depth - 1];
+
+            if (!expected)
+                break;
+
+            const int64_t start = system_nsec();
+            const uint64_t leaves = gen_perft(&pos, depth, 1);
+            const int64_t nsec = max(system_nsec() - start, (int64_t)1);
+
+            nodes += leaves;
+            elapsed += nsec;
+            ok = ok && leaves == expected;
+
+            printf("depth %d: %" PRIu64 " %s, %.3fms, %.0f nps\n", depth, leaves,
+                leaves == expected ? "ok" : "FAILED", nsec / 1e6, leaves * 1e9 / nsec);
+        }
+
+        passed += ok;
+        puts("");
+    }
+
+    printf("pass  : %d/%d\n", passed, count);
+    printf("time  : %" PRId64 "ms\n", elapsed / 1000000);
+    printf("nodes : %" PRIu64 "\n", nodes);
+    printf("nps   : %.0f\n", nodes * 1e9 / max(elapsed, (int64_t)1));
+
+    return passed == count;
+}
+
+// Micro-benchmark corpus: the bench positions, and the positions reached by playing random legal
+// moves from each of them.
+enum {
+    RANDOM_PLIES = 32,
+    NB_GAMES = sizeof(BenchFens) / sizeof(BenchFens[0]) - 1,
+    NB_SAMPLES = NB_GAMES * (RANDOM_PLIES + 1),
+    NB_KEYS = 1 << 22,  // 64MB worth of entries, to defeat the LLC
+    NB_WARM_KEYS = 1 << 9,  // 512 entries = 8KB, fits in L1
+    MIN_NSEC = 200000000
+};
+
+typedef struct {
+    Position pos;
+    move_t pseudo[MAX_MOVES], legal[MAX_MOVES];
+    int pseudoCnt, legalCnt, game, ply;
+} Sample;
+
+static Sample *Samples;
+static int SamplesCount;
+static ZobristStack Games[NB_GAMES];
+static uint64_t *Keys;
+static volatile uint64_t Sink;  // consume results, so that the compiler cannot optimize away calls
+
+static void init_corpus(void)
+{
+    uint64_t state = 0;
+    Samples = malloc(NB_SAMPLES * sizeof(Sample));
+    Keys = malloc(NB_KEYS * sizeof(uint64_t));
+
+    if (!Samples || !Keys) {
+        perror("microbench");
+        exit(EXIT_FAILURE);
+    }
+
+    SamplesCount = 0;
+
+    for (int game = 0; game < NB_GAMES; game++) {
+        Position pos;
+        pos_set(&pos, BenchFens[game]);
+        zobrist_clear(&Games[game]);
+        zobrist_push(&Games[game], pos.key);
+
+        for (int ply = 0; ply <= RANDOM_PLIES; ply++) {
+            Sample *s = &Samples[SamplesCount++];
+            s->pos = pos;
+            s->game = game;
+            s->ply = ply;
+            s->pseudoCnt = (int)(gen_all_moves(&pos, s->pseudo) - s->pseudo);
+            s->legalCnt = 0;
+
+            const bitboard_t pins = calc_pins(&pos);
+
+            for (int i = 0; i < s->pseudoCnt; i++)
+                if (gen_is_legal(&pos, pins, s->pseudo[i]))
+                    s->legal[s->legalCnt++] = s->pseudo[i];
+
+            if (!s->legalCnt || pos.rule50 >= 99)
+                break;
+
+            Position nextPos;
+            pos_move(&nextPos, &pos, s->legal[prng(&state) % (uint64_t)s->legalCnt]);
+            pos = nextPos;
+            zobrist_push(&Games[game], pos.key);
+        }
+    }
+
+    for (int i = 0; i < NB_KEYS; i++)
+        Keys[i] = prng(&state);
+}
+
+static uint64_t mb_pos_move(void)
+{
+    uint64_t ops = 0, sink = 0;
+
+    for (int i = 0; i < SamplesCount; i++) {
+        const Sample *s = &Samples[i];
+
+        for (int j = 0; j < s->legalCnt; j++) {
+            Position nextPos;
+            pos_move(&nextPos, &s->pos, s->legal[j]);
+            sink += nextPos.key ^ nextPos.attacked ^ nextPos.checkers;
+        }
+
+        ops += (uint64_t)s->legalCnt;
+    }
+
+    Sink = sink;
+    return ops;
+}
+
+static uint64_t mb_pos_switch(void)
+{
+    uint64_t ops = 0, sink = 0;
+
+    for (int i = 0; i < SamplesCount; i++)
+        if (!Samples[i].pos.checkers) {
+            Position nextPos;
+            pos_switch(&nextPos, &Samples[i].pos);
+            sink += nextPos.key ^ nextPos.attacked ^ nextPos.checkers;
+            ops++;
+        }
+
+    Sink = sink;
+    return ops;
+}
+
+static uint64_t mb_gen_pawn_moves(void)
+{
+    uint64_t ops = 0, sink = 0;
+
+    for (int i = 0; i < SamplesCount; i++) {
+        const Position *pos = &Samples[i].pos;
+
+        if (!pos->checkers) {
+            move_t mList[MAX_MOVES];
+            sink += (uint64_t)(gen_pawn_moves(pos, mList, ~pos->byColor[pos->turn], true) - mList);
+            ops++;
+        }
+    }
+
+    Sink = sink;
+    return ops;
+}
+
+static uint64_t mb_gen_piece_moves(void)
+{
+    uint64_t ops = 0, sink = 0;
+
+    for (int i = 0; i < SamplesCount; i++) {
+        const Position *pos = &Samples[i].pos;
+
+        if (!pos->checkers) {
+            move_t mList[MAX_MOVES];
+            sink += (uint64_t)(gen_piece_moves(pos, mList, ~pos->byColor[pos->turn], true) - mList);
+            ops++;
+        }
+    }
+
+    Sink = sink;
+    return ops;
+}
+
+static uint64_t mb_gen_is_legal(void)
+{
+    uint64_t ops = 0, sink = 0;
+
+    for (int i = 0; i < SamplesCount; i++) {
+        const Sample *s = &Samples[i];
+        const bitboard_t pins = calc_pins(&s->pos);
+
+        for (int j = 0; j < s->pseudoCnt; j++)
+            sink += gen_is_legal(&s->pos, pins, s->pseudo[j]);
+
+        ops += (uint64_t)s->pseudoCnt;
+    }
+
+    Sink = sink;
+    return ops;
+}
+
+static uint64_t mb_calc_pins(void)
+{
+    uint64_t sink = 0;
+
+    for (int i = 0; i < SamplesCount; i++)
+        sink += calc_pins(&Samples[i].pos);
+
+    Sink = sink;
+    return (uint64_t)SamplesCount;
+}
+
+static uint64_t mb_pos_see(void)
+{
+    uint64_t ops = 0, sink = 0;
+
+    for (int i = 0; i < SamplesCount; i++) {
+        const Sample *s = &Samples[i];
+
+        for (int j = 0; j < s->legalCnt; j++)
+            sink += (uint64_t)pos_see(&s->pos, s->legal[j]);
+
+        ops += (uint64_t)s->legalCnt;
+    }
+
+    Sink = sink;
+    return ops;
+}
+
+static uint64_t do_evaluate(bool pawnHashHits)
+{
+    uint64_t ops = 0, sink = 0;
+
+    for (int i = 0; i < SamplesCount; i++) {
+        const Position *pos = &Samples[i].pos;
+
+        if (!pos->checkers && !pos_insufficient_material(pos)) {
+            if (!pawnHashHits)
+                Workers[0].pawnHash[pos->kingPawnKey % NB_PAWN_HASH].key = 0;
+
+            sink += (uint64_t)evaluate(&Workers[0], pos);
+            ops++;
+        }
+    }
+
+    Sink = sink;
+    return ops;
+}
+
+static uint64_t mb_evaluate_miss(void) { return do_evaluate(false); }
+static uint64_t mb_evaluate_hit(void) { return do_evaluate(true); }
+
+static uint64_t mb_bb_rook_attacks(void)
+{
+    uint64_t sink = 0;
+
+    for (int i = 0; i < SamplesCount; i++) {
+        const bitboard_t occ = pos_pieces(&Samples[i].pos);
+
+        for (int square = A1; square <= H8; square++)
+            sink += bb_rook_attacks(square, occ);
+    }
+
+    Sink = sink;
+    return (uint64_t)SamplesCount * NB_SQUARE;
+}
+
+static uint64_t do_hash_read(int mask)
+{
+    uint64_t sink = 0;
+    HashEntry he;
+
+    for (int i = 0; i < NB_KEYS; i++)
+        sink += hash_read(Keys[i & mask], &he, 0);
+
+    Sink = sink;
+    return NB_KEYS;
+}
+
+static uint64_t do_hash_write(int mask)
+{
+    HashEntry he = {.score = 0, .eval = 0, .move = 0, .depth = 1, .bound = EXACT};
+
+    for (int i = 0; i < NB_KEYS; i++)
+        hash_write(Keys[i & mask], &he, 0);
+
+    return NB_KEYS;
+}
+
+static uint64_t mb_hash_read_cold(void) { return do_hash_read(NB_KEYS - 1); }
+static uint64_t mb_hash_read_warm(void) { return do_hash_read(NB_WARM_KEYS - 1); }
+static uint64_t mb_hash_write_cold(void) { return do_hash_write(NB_KEYS - 1); }
+static uint64_t mb_hash_write_warm(void) { return do_hash_write(NB_WARM_KEYS - 1); }
+
+static uint64_t mb_zobrist_repetition(void)
+{
+    uint64_t sink = 0;
+
+    for (int i = 0; i < SamplesCount; i++) {
+        ZobristStack *st = &Games[Samples[i].game];
+        st->idx = Samples[i].ply + 1;
+        sink += zobrist_repetition(st, &Samples[i].pos);
+    }
+
+    Sink = sink;
+    return (uint64_t)SamplesCount;
+}
+
+static void microbench_run(PerfCounters *pc, const char *name, uint64_t (*pass)(void))
+{
+    pass();  // warm up (caches, branch predictors, pawn hash)
+
+    uint64_t ops = 0;
+    int64_t elapsed = 0;
+    perf_start(pc);
+    const int64_t start = system_nsec();
+
+    do {
+        ops += pass();
+    } while ((elapsed = system_nsec() - start) < MIN_NSEC);
+
+    perf_stop(pc);
+
+    const double nsPerOp = (double)elapsed / ops;
+    printf("%-20s: %8.2f ns/op, %9.2f Mop/s", name, nsPerOp, 1000 / nsPerOp);
+
+    if (pc->fd[PERF_CYCLES] >= 0 && pc->fd[PERF_INSTRUCTIONS] >= 0)
+        printf(", %8.1f cycles/op, IPC %.2f", pc->count[PERF_CYCLES] / ops,
+            pc->count[PERF_INSTRUCTIONS] / max(pc->count[PERF_CYCLES], 1.0));
+
+    if (pc->fd[PERF_LLC_MISSES] >= 0 && pc->fd[PERF_DTLB_MISSES] >= 0)
+        printf(", LLC %.3f/op, dTLB %.3f/op", pc->count[PERF_LLC_MISSES] / ops,
+            pc->count[PERF_DTLB_MISSES] / ops);
+
+    puts("");
+}
+
+void microbench()
+{
+    init_corpus();
+    uciChess960 = true;
+    printf("corpus: %d positions\n", SamplesCount);
+
+    PerfCounters pc;
+    perf_open(&pc);
+
+    if (!perf_available(&pc))
+        puts("perf  : hardware counters unavailable");
+
+    microbench_run(&pc, "pos_move", mb_pos_move);
+    microbench_run(&pc, "pos_switch", mb_pos_switch);
+    microbench_run(&pc, "gen_pawn_moves", mb_gen_pawn_moves);
+    microbench_run(&pc, "gen_piece_moves", mb_gen_piece_moves);
+    microbench_run(&pc, "gen_is_legal", mb_gen_is_legal);
+    microbench_run(&pc, "calc_pins", mb_calc_pins);
+    microbench_run(&pc, "pos_see", mb_pos_see);
+    microbench_run(&pc, "evaluate (pawn miss)", mb_evaluate_miss);
+    microbench_run(&pc, "evaluate (pawn hit)", mb_evaluate_hit);
+    microbench_run(&pc, "bb_rook_attacks", mb_bb_rook_attacks);
+    microbench_run(&pc, "hash_read (cold)", mb_hash_read_cold);
+    microbench_run(&pc, "hash_read (warm)", mb_hash_read_warm);
+    microbench_run(&pc, "hash_write (cold)", mb_hash_write_cold);
+    microbench_run(&pc, "hash_write (warm)", mb_hash_write_warm);
+    microbench_run(&pc, "zobrist_repetition", mb_zobrist_repetition);
+
+    perf_close(&pc);
+    free(Samples);
+    free(Keys);
+}
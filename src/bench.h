@@ -0,0 +1,11 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+void bench(int depth);
+void bench_scaling(int depth, int maxThreads, int runs);
+void bench_throughput(int depth, int procs, size_t hashMB);
+void bench_compare(const char *engines[2], int runs, int depth);
+void bench_latency(const char *exe, int rounds, int movetime, size_t hashMB);
+void microbench(void);
+bool perft_suite(int maxDepth);
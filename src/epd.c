@@ -0,0 +1,283 @@
+/*
+ * Demolito, a UCI chess engine. Copyright 2015-2020 lucasart.
+ *
+ * Demolito is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * Demolito is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program. If
+ * not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "epd.h"
+#include "gen.h"
+#include "htable.h"
+#include "search.h"
+#include "uci.h"
+#include "util.h"
+#include "workers.h"
+
+enum {MAX_EPD_MOVES = 8, MAX_EPD_LINE = 1024};
+
+typedef struct {
+    char fen[MAX_FEN], id[64];
+    move_t bm[MAX_EPD_MOVES], am[MAX_EPD_MOVES];
+    int bmCnt, amCnt;
+} Epd;
+
+// Grow (or allocate) an array. Failure is fatal, like in hash_prepare().
+static int64_t *epd_grow(int64_t *array, int capacity)
+{
+    int64_t *result = realloc(array, (size_t)capacity * sizeof(int64_t));
+
+    if (!result) {
+        perror("epd");
+        exit(EXIT_FAILURE);
+    }
+
+    return result;
+}
+
+static int legal_moves(const Position *pos, move_t *mList)
+{
+    const bitboard_t pins = calc_pins(pos);
+    move_t *end = gen_all_moves(pos, mList), *it = mList;
+
+    for (move_t *m = mList; m != end; m++)
+        if (gen_is_legal(pos, pins, *m))
+            *it++ = *m;
+
+    return (int)(it - mList);
+}
+
+// SAN notation, without check/mate suffix and without '=' for promotions (eg. "exd8Q")
+static void move_to_san(const Position *pos, const move_t *mList, int cnt, move_t m, char *str)
+{
+    const int from = move_from(m), to = move_to(m), prom = move_prom(m);
+    const int piece = pos->pieceOn[from];
+
+    if (pos_move_is_castling(pos, m)) {
+        strcpy(str, to > from ? "O-O" : "O-O-O");
+        return;
+    }
+
+    const bool capture = bb_test(pos->byColor[opposite(pos->turn)], to)
+        || (piece == PAWN && to == pos->epSquare);
+
+    if (piece == PAWN) {
+        if (capture)
+            *str++ = file_of(from) + 'a';
+    } else {
+        *str++ = PieceLabel[WHITE][piece];
+
+        // Disambiguate from other pieces of the same type, that can legally go to the same square
+        bitboard_t others = 0;
+
+        for (int i = 0; i < cnt; i++)
+            if (move_to(mList[i]) == to && move_from(mList[i]) != from
+                    && pos->pieceOn[move_from(mList[i])] == piece)
+                bb_set(&others, move_from(mList[i]));
+
+        if (others) {
+            if (!(others & File[file_of(from)]))
+                *str++ = file_of(from) + 'a';
+            else if (!(others & Rank[rank_of(from)]))
+                *str++ = rank_of(from) + '1';
+            else {
+                square_to_string(from, str);
+                str += 2;
+            }
+        }
+    }
+
+    if (capture)
+        *str++ = 'x';
+
+    square_to_string(to, str);
+    str += 2;
+
+    if (prom < NB_PIECE)
+        *str++ = PieceLabel[WHITE][prom];
+
+    *str = '\0';
+}
+
+// Parse a move in SAN (or UCI notation). Returns 0 if it is not a legal move.
+static move_t parse_move(const Position *pos, const char *token)
+{
+    // Normalize: remove annotations ('+', '#', '!', '?'), '=', and castling written with zeros
+    char move[16], *s = move;
+
+    for (; *token && s < move + sizeof(move) - 1; token++)
+        if (!strchr("+#!?=", *token))
+            *s++ = *token == '0' ? 'O' : *token;
+
+    *s = '\0';
+
+    move_t mList[MAX_MOVES];
+    const int cnt = legal_moves(pos, mList);
+
+    for (int i = 0; i < cnt; i++) {
+        char san[16], uci[6];
+        move_to_san(pos, mList, cnt, mList[i], san);
+        pos_move_to_string(pos, mList[i], uci);
+
+        if (!strcmp(san, move) || !strcmp(uci, move))
+            return mList[i];
+    }
+
+    return 0;
+}
+
+// Parse EPD line: 4 FEN fields, followed by operations (eg. 'bm Qxf7+ Rd8; id "WAC.002";')
+static bool epd_parse(const char *line, Epd *e)
+{
+    // Longest board: 8 digits or pieces per rank, and 7 '/'. Anything longer is not a valid FEN.
+    char board[72], turn[2], castling[5], ep[3];
+    int boardEnd = 0, n = 0;
+
+    if (sscanf(line, "%71s%n %1s %4s %2s %n", board, &boardEnd, turn, castling, ep, &n) != 4
+            || line[boardEnd] != ' ')
+        return false;
+
+    snprintf(e->fen, sizeof e->fen, "%s %s %s %s 0 1", board, turn, castling, ep);
+    e->bmCnt = e->amCnt = 0;
+    e->id[0] = '\0';
+
+    Position pos;
+    pos_set(&pos, e->fen);
+
+    char ops[MAX_EPD_LINE], *opsPos;
+    snprintf(ops, sizeof ops, "%s", line + n);
+
+    for (char *op = strtok_r(ops, ";\n", &opsPos); op; op = strtok_r(NULL, ";\n", &opsPos)) {
+        char *tokenPos, *token = strtok_r(op, " ", &tokenPos);
+
+        if (!token)
+            continue;
+
+        if (!strcmp(token, "id") && (token = strtok_r(NULL, "\"", &tokenPos)))
+            snprintf(e->id, sizeof e->id, "%s", token);
+        else if (!strcmp(token, "bm") || !strcmp(token, "am")) {
+            const bool bm = !strcmp(token, "bm");
+
+            while ((token = strtok_r(NULL, " ", &tokenPos))) {
+                const move_t m = parse_move(&pos, token);
+
+                if (m && bm && e->bmCnt < MAX_EPD_MOVES)
+                    e->bm[e->bmCnt++] = m;
+                else if (m && !bm && e->amCnt < MAX_EPD_MOVES)
+                    e->am[e->amCnt++] = m;
+            }
+        }
+    }
+
+    return e->bmCnt || e->amCnt;
+}
+
+static bool solves(const Epd *e, move_t m)
+{
+    for (int i = 0; i < e->amCnt; i++)
+        if (e->am[i] == m)
+            return false;
+
+    for (int i = 0; i < e->bmCnt; i++)
+        if (e->bm[i] == m)
+            return true;
+
+    return !e->bmCnt;  // am only: any other move solves
+}
+
+// Search each position of an EPD test suite, with a time and/or node limit, and report the time
+// and nodes to solution: when the best move last changed to the final (correct) one.
+bool epd_run(const char *fileName, int64_t movetime, uint64_t nodes)
+{
+    FILE *in = fopen(fileName, "r");
+
+    if (!in)
+        return false;
+
+    char line[MAX_EPD_LINE];
+    int total = 0, solved = 0, capacity = 256;
+    int64_t *times = epd_grow(NULL, capacity), *nodeCounts = epd_grow(NULL, capacity);
+    uciQuiet = true;
+
+    while (fgets(line, sizeof line, in)) {
+        Epd e;
+
+        if (!epd_parse(line, &e))
+            continue;
+
+        // Search from scratch, like after ucinewgame
+        hash_new_epoch();
+        workers_clear();
+        search_clear();
+
+        pos_set(&rootPos, e.fen);
+        zobrist_clear(&rootStack);
+        zobrist_push(&rootStack, rootPos.key);
+
+        lim = (Limits){0};
+        lim.depth = MAX_DEPTH;
+        lim.movetime = movetime;
+        lim.nodes = nodes;
+
+        search_go();
+        total++;
+
+        if (!e.id[0])
+            snprintf(e.id, sizeof e.id, "#%d", total);
+
+        // Search is over: read ui directly (no lock needed)
+        char best[6];
+        pos_move_to_string(&rootPos, ui.best, best);
+
+        if (solves(&e, ui.best)) {
+            if (solved == capacity) {
+                capacity *= 2;
+                times = epd_grow(times, capacity);
+                nodeCounts = epd_grow(nodeCounts, capacity);
+            }
+
+            times[solved] = ui.bestTime;
+            nodeCounts[solved++] = (int64_t)ui.bestNodes;
+            printf("%-16s solved  %s, time %" PRId64 "ms, nodes %" PRIu64 "\n", e.id, best,
+                ui.bestTime, ui.bestNodes);
+        } else
+            printf("%-16s FAILED  %s\n", e.id, best);
+
+        fflush(stdout);
+    }
+
+    fclose(in);
+    uciQuiet = false;
+
+    printf("solved: %d/%d\n", solved, total);
+
+    if (solved) {
+        int64_t sumTime = 0, sumNodes = 0;
+
+        for (int i = 0; i < solved; i++) {
+            sumTime += times[i];
+            sumNodes += nodeCounts[i];
+        }
+
+        qsort(times, (size_t)solved, sizeof(int64_t), compare_int64);
+        qsort(nodeCounts, (size_t)solved, sizeof(int64_t), compare_int64);
+
+        printf("time  : average %" PRId64 "ms, median %" PRId64 "ms\n", sumTime / solved,
+            times[solved / 2]);
+        printf("nodes : average %" PRId64 ", median %" PRId64 "\n", sumNodes / solved,
+            nodeCounts[solved / 2]);
+    }
+
+    free(times);
+    free(nodeCounts);
+    return true;
+}
@@ -0,0 +1,5 @@
+#pragma once
+#include <inttypes.h>
+#include <stdbool.h>
+
+bool epd_run(const char *fileName, int64_t movetime, uint64_t nodes);
@@ -274,10 +274,13 @@ static eval_t pawns(Worker *worker, const Position *pos, bitboard_t attacks[NB_C
     PawnEntry *pe = &worker->pawnHash[key % NB_PAWN_HASH];
     eval_t e;
 
+    STAT_INC(worker, pawnProbes);
+
     // First the king+pawn squeleton only, using PawhHash
-    if (pe->key == key)
+    if (pe->key == key) {
         e = pe->eval;
-    else {
+        STAT_INC(worker, pawnHits);
+    } else {
         pe->key = key;
         pe->passed = 0;
         pe->eval = do_pawns(pos, WHITE, attacks, &pe->passed);
@@ -34,7 +34,7 @@ static move_t *serialize_pawn_moves(bitboard_t pawns, int shift, move_t *mList)
     return mList;
 }
 
-static move_t *gen_all_moves(const Position *pos, move_t *mList)
+move_t *gen_all_moves(const Position *pos, move_t *mList)
 {
     if (pos->checkers)
         return gen_check_escapes(pos, mList, true);
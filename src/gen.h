@@ -9,6 +9,7 @@ move_t *gen_pawn_moves(const Position *pos, move_t *mList, bitboard_t filter, bo
 move_t *gen_piece_moves(const Position *pos, move_t *mList, bitboard_t filter, bool kingMoves);
 move_t *gen_castling_moves(const Position *pos, move_t *mList);
 move_t *gen_check_escapes(const Position *pos, move_t *mList, bool subPromotions);
+move_t *gen_all_moves(const Position *pos, move_t *mList);
 
 // Verify legality of pseudo-legal moves generates by the above
 bool gen_is_legal(const Position *pos, bitboard_t pins, move_t m);
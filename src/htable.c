@@ -12,16 +12,42 @@
  * You should have received a copy of the GNU General Public License along with this program. If
  * not, see <http://www.gnu.org/licenses/>.
 */
+#ifdef __linux__
+    #include <sys/sysinfo.h>
+#endif
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "bitboard.h"
 #include "htable.h"
 #include "platform.h"
 #include "search.h"
+#include "util.h"
+#include "workers.h"
 
 unsigned hashDate = 0;
 HashEntry *HashTable = NULL;
 size_t HashCount = 0;
 
+// Keys are stored XOR'ed with a salt, which changes every epoch (new game). Entries from previous
+// epochs then simply fail the key check, so the table never needs to be wiped. This is equivalent
+// to a 64-bit generation stamp, without making HashEntry any bigger.
+static uint64_t hashEpoch = 0, hashSalt = 0;
+
+// Entry stored at index i, of a table of count entries, belongs to the current epoch. An entry of a
+// previous epoch unsalts to a key that maps to another index (except with probability 1 / count).
+static bool hash_epoch(const HashEntry *e, size_t i, size_t count)
+{
+    return e->key && ((e->key ^ hashSalt) & (count - 1)) == i;
+}
+
+// Entry stored at index i belongs to the current search: same date and same epoch. The date alone
+// is not enough, as it wraps every 64 searches.
+static bool hash_current(const HashEntry *e, size_t i)
+{
+    return e->date == hashDate % 64 && hash_epoch(e, i, HashCount);
+}
+
 static int score_to_hash(int score, int ply)
 {
     if (score >= mate_in(MAX_PLY))
@@ -51,12 +77,20 @@ static __attribute__((destructor)) void hash_free(void)
     free(HashTable);
 }
 
-void hash_prepare(uint64_t hashMB)
+uint64_t hash_prepare(uint64_t hashMB)
 {
     assert(bb_count(hashMB) == 1);  // must be a power of 2
 
     free(HashTable);
-    HashTable = malloc(hashMB << 20);
+
+    // If allocation fails, fall back to smaller sizes, rather than crash on a NULL HashTable
+    while (!(HashTable = malloc(hashMB << 20)) && hashMB > 1)
+        hashMB /= 2;
+
+    if (!HashTable) {
+        fputs("hash_prepare(): cannot allocate memory\n", stderr);
+        exit(EXIT_FAILURE);
+    }
 
     // All 64-bit malloc() implementations should return 16-byte aligned memory.
     // We want this for performance, to ensure that no HashEntry sits across two
@@ -65,13 +99,242 @@ void hash_prepare(uint64_t hashMB)
 
     HashCount = (hashMB << 20) / sizeof(HashEntry);
     memset(HashTable, 0, hashMB << 20);
+
+    return hashMB;
+}
+
+// Entry a is worth more than b, both for index i of a table of count entries: current epoch first,
+// then current date, then depth
+static bool hash_better(const HashEntry *a, const HashEntry *b, size_t i, size_t count)
+{
+    const bool aEpoch = hash_epoch(a, i, count), bEpoch = hash_epoch(b, i, count);
+
+    if (aEpoch != bEpoch)
+        return aEpoch;
+
+    const bool aCurrent = aEpoch && a->date == hashDate % 64;
+    const bool bCurrent = bEpoch && b->date == hashDate % 64;
+
+    return aCurrent != bCurrent ? aCurrent : aEpoch && a->depth > b->depth;
+}
+
+typedef struct {
+    size_t lo, hi, oldCount, newCount;
+} HashSlice;
+
+// Sizes are powers of 2, and the index is the low bits of the key. So resizing only changes the
+// upper index bits: entry i of the small table corresponds to entries i + k * smallCount of the big
+// one. Each thread owns a slice [lo, hi) of the small table, and all its images in the big one.
+static void *hash_migrate(void *_slice)
+{
+    const HashSlice *s = _slice;
+
+    if (s->newCount > s->oldCount) {
+        // Grow: clear the new blocks, then move entries whose upper key bits point there. Entries
+        // of previous epochs unsalt to unrelated indices, possibly in another thread's slice: they
+        // are useless anyway, so clear them.
+        for (size_t k = s->oldCount; k < s->newCount; k += s->oldCount)
+            memset(&HashTable[k + s->lo], 0, (s->hi - s->lo) * sizeof(HashEntry));
+
+        for (size_t i = s->lo; i < s->hi; i++) {
+            const size_t j = (HashTable[i].key ^ hashSalt) & (s->newCount - 1);
+
+            if (!hash_epoch(&HashTable[i], i, s->oldCount))
+                HashTable[i] = (HashEntry){0};
+            else if (j != i) {
+                assert((j & (s->oldCount - 1)) == i);
+                HashTable[j] = HashTable[i];
+                HashTable[i] = (HashEntry){0};
+            }
+        }
+    } else {
+        // Shrink: fold the upper blocks onto the first one, keeping the best entry of each set
+        for (size_t k = s->newCount; k < s->oldCount; k += s->newCount)
+            for (size_t i = s->lo; i < s->hi; i++)
+                if (hash_better(&HashTable[k + i], &HashTable[i], i, s->newCount))
+                    HashTable[i] = HashTable[k + i];
+    }
+
+    return NULL;
+}
+
+static void hash_migrate_all(size_t oldCount, size_t newCount)
+{
+    const size_t count = min(oldCount, newCount);
+    const size_t threadsCount = max(WorkersCount, 1);  // count is at least 64K entries
+    pthread_t threads[threadsCount];
+    HashSlice slices[threadsCount];
+
+    for (size_t i = 0; i < threadsCount; i++) {
+        slices[i] = (HashSlice){count * i / threadsCount, count * (i + 1) / threadsCount,
+            oldCount, newCount};
+        pthread_create(&threads[i], NULL, hash_migrate, &slices[i]);
+    }
+
+    for (size_t i = 0; i < threadsCount; i++)
+        pthread_join(threads[i], NULL);
+}
+
+uint64_t hash_resize(uint64_t hashMB)
+{
+    assert(bb_count(hashMB) == 1);  // must be a power of 2
+
+    if (!HashTable)
+        return hash_prepare(hashMB);
+
+    const size_t oldCount = HashCount;
+    const uint64_t oldMB = (oldCount * sizeof(HashEntry)) >> 20;
+
+    if (hashMB < oldMB) {
+        // Migrate first, while the upper blocks are still there. Shrinking in place can't fail.
+        const size_t newCount = (hashMB << 20) / sizeof(HashEntry);
+        hash_migrate_all(oldCount, newCount);
+        HashCount = newCount;
+
+        HashEntry *table = realloc(HashTable, hashMB << 20);
+        HashTable = table ? table : HashTable;
+    } else if (hashMB > oldMB) {
+        // realloc() can often grow in place (mremap for large blocks), without a copy. On failure,
+        // fall back to smaller sizes, and keep the current table if nothing bigger fits.
+        HashEntry *table;
+
+        while (!(table = realloc(HashTable, hashMB << 20)) && hashMB > oldMB)
+            hashMB /= 2;
+
+        if (!table)
+            return oldMB;
+
+        HashTable = table;
+        assert((uintptr_t)HashTable % sizeof(HashEntry) == 0);
+
+        HashCount = (hashMB << 20) / sizeof(HashEntry);
+        hash_migrate_all(oldCount, HashCount);
+    }
+
+    return hashMB;
+}
+
+#ifdef __linux__
+// Read a single number (in bytes) from a file. Returns 0 if missing, or "max" (unlimited).
+static uint64_t read_bytes(const char *fileName)
+{
+    FILE *in = fopen(fileName, "r");
+    uint64_t bytes = 0;
+
+    if (in) {
+        if (fscanf(in, "%" SCNu64, &bytes) != 1)
+            bytes = 0;
+
+        fclose(in);
+    }
+
+    return bytes;
+}
+
+// Memory limit of our cgroup, minus what it already uses. Returns 0 if unlimited or unknown.
+static uint64_t cgroup_available(uint64_t *limit)
+{
+    // cgroup v2: the path of our cgroup is on the "0::" line of /proc/self/cgroup
+    char path[512] = "", fileName[600];
+    FILE *in = fopen("/proc/self/cgroup", "r");
+
+    if (in) {
+        char line[512];
+
+        while (fgets(line, sizeof line, in))
+            if (!strncmp(line, "0::", 3)) {
+                line[strcspn(line, "\n")] = '\0';
+                snprintf(path, sizeof path, "%s", strcmp(line + 3, "/") ? line + 3 : "");
+            }
+
+        fclose(in);
+    }
+
+    snprintf(fileName, sizeof fileName, "/sys/fs/cgroup%s/memory.max", path);
+    uint64_t usage = 0;
+
+    if ((*limit = read_bytes(fileName))) {
+        snprintf(fileName, sizeof fileName, "/sys/fs/cgroup%s/memory.current", path);
+        usage = read_bytes(fileName);
+    } else if ((*limit = read_bytes("/sys/fs/cgroup/memory/memory.limit_in_bytes"))) {
+        // cgroup v1: unlimited is reported as a huge number (page counter max)
+        if (*limit >= 1ULL << 60)
+            *limit = 0;
+        else
+            usage = read_bytes("/sys/fs/cgroup/memory/memory.usage_in_bytes");
+    }
+
+    return *limit > usage ? *limit - usage : *limit ? 1 : 0;
+}
+
+static uint64_t system_available(void)
+{
+    // MemAvailable accounts for reclaimable page cache. Fall back to sysinfo() on old kernels.
+    FILE *in = fopen("/proc/meminfo", "r");
+    char line[256];
+    uint64_t kB = 0;
+
+    if (in) {
+        while (fgets(line, sizeof line, in))
+            if (sscanf(line, "MemAvailable: %" SCNu64 " kB", &kB) == 1)
+                break;
+
+        fclose(in);
+    }
+
+    if (kB)
+        return kB << 10;
+
+    struct sysinfo si;
+    return sysinfo(&si) ? 0 : ((uint64_t)si.freeram + si.bufferram) * si.mem_unit;
+}
+#elif defined(_WIN64)
+static uint64_t cgroup_available(uint64_t *limit)
+{
+    return *limit = 0;
+}
+
+static uint64_t system_available(void)
+{
+    MEMORYSTATUSEX ms = {.dwLength = sizeof(ms)};
+    return GlobalMemoryStatusEx(&ms) ? ms.ullAvailPhys : 0;
+}
+#else
+static uint64_t cgroup_available(uint64_t *limit)
+{
+    return *limit = 0;
+}
+
+static uint64_t system_available(void)
+{
+    return 0;
+}
+#endif
+
+uint64_t hash_auto(uint64_t *availableMB, uint64_t *cgroupMB)
+{
+    uint64_t cgroupLimit, available = system_available();
+    const uint64_t cgroup = cgroup_available(&cgroupLimit);
+
+    if (cgroup && (!available || cgroup < available))
+        available = cgroup;
+
+    *availableMB = available >> 20;
+    *cgroupMB = cgroupLimit >> 20;
+
+    // Leave headroom for Workers, the rest of the process, and whatever else runs on the machine:
+    // use at most half of what remains, rounded down to a power of 2.
+    const uint64_t reserved = WorkersCount * sizeof(Worker) + (64ULL << 20);
+    const uint64_t usableMB = available > reserved ? (available - reserved) / 2 >> 20 : 0;
+
+    return usableMB ? 1ULL << bb_msb(min(usableMB, 1ULL << 20)) : 1;
 }
 
 bool hash_read(uint64_t key, HashEntry *e, int ply)
 {
     *e = HashTable[key & (HashCount - 1)];
 
-    if (e->key == key) {
+    if (e->key == (key ^ hashSalt)) {
         e->score = score_from_hash(e->score, ply);
         return true;
     }
@@ -81,18 +344,50 @@ bool hash_read(uint64_t key, HashEntry *e, int ply)
 
 void hash_write(uint64_t key, HashEntry *e, int ply)
 {
-    HashEntry *slot = &HashTable[key & (HashCount - 1)];
+    const size_t i = key & (HashCount - 1);
+    HashEntry *slot = &HashTable[i];
 
     e->date = hashDate;
     assert(e->date == hashDate % 64);
 
-    if (e->date != slot->date || e->depth >= slot->depth) {
+    if (!hash_current(slot, i) || e->depth >= slot->depth) {
         e->score = score_to_hash(e->score, ply);
-        e->key = key;
+        e->key = key ^ hashSalt;
         *slot = *e;
     }
 }
 
+// Private table of a worker (Private Hash option), for qsearch and depth 1 nodes. Always replace.
+// Keeping them out of the shared table saves write traffic on shared cache lines (SMP), and avoids
+// evicting deeper entries. No salt needed: workers_clear() wipes it for a new game.
+bool qhash_read(const HashEntry *table, uint64_t key, HashEntry *e, int ply)
+{
+    *e = table[key & (NB_QHASH - 1)];
+
+    if (e->key == key) {
+        e->score = score_from_hash(e->score, ply);
+        return true;
+    }
+
+    return false;
+}
+
+void qhash_write(HashEntry *table, uint64_t key, HashEntry *e, int ply)
+{
+    e->score = score_to_hash(e->score, ply);
+    e->key = key;
+    table[key & (NB_QHASH - 1)] = *e;
+}
+
+// Invalidate all entries in O(1), by starting a new epoch. Replacement then prefers entries from
+// previous epochs, regardless of their depth (see hash_current()).
+void hash_new_epoch()
+{
+    hashEpoch++;
+    hashSalt = hash(&hashEpoch, sizeof hashEpoch, 0);
+    hashDate++;
+}
+
 void hash_prefetch(uint64_t key)
 {
     __builtin_prefetch(&HashTable[key & (HashCount - 1)]);
@@ -103,7 +398,7 @@ int hash_permille()
     int result = 0;
 
     for (int i = 0; i < 1000; i++)
-        result += HashTable[i].key && HashTable[i].date == hashDate % 64;
+        result += hash_current(&HashTable[i], (size_t)i);
 
     return result;
 }
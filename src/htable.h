@@ -18,10 +18,18 @@ typedef struct {
     };
 } HashEntry;
 
-void hash_prepare(uint64_t hashMB);  // realloc + clear
+enum {NB_QHASH = 16384};  // private table of each worker (Private Hash): 256KB, fits in L2
+
+uint64_t hash_prepare(uint64_t hashMB);  // realloc + clear, returns actual size (smaller if OOM)
+uint64_t hash_resize(uint64_t hashMB);  // realloc, preserving entries, returns actual size
+uint64_t hash_auto(uint64_t *availableMB, uint64_t *cgroupMB);  // size (MB) fitting free memory
 bool hash_read(uint64_t key, HashEntry *e, int ply);
 void hash_write(uint64_t key, HashEntry *e, int ply);
 void hash_prefetch(uint64_t key);
+void hash_new_epoch(void);  // O(1) clear: invalidates all entries
+
+bool qhash_read(const HashEntry *table, uint64_t key, HashEntry *e, int ply);
+void qhash_write(HashEntry *table, uint64_t key, HashEntry *e, int ply);
 
 int hash_permille(void);
 
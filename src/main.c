@@ -14,55 +14,19 @@
 */
 #include <stdlib.h>
 #include <string.h>
+#include "bench.h"
 #include "bitboard.h"
+#include "epd.h"
 #include "eval.h"
+#include "nnfeatures.h"
 #include "htable.h"
 #include "platform.h"
-#include "position.h"
 #include "search.h"
+#include "trace.h"
+#include "tune.h"
 #include "uci.h"
-#include "util.h"
 #include "workers.h"
 
-void bench(int depth)
-{
-    static const char *fens[] = {
-        #include "test.csv"
-        NULL
-    };
-
-    uint64_t nodes = 0, seal = 0;
-    uciChess960 = true;
-
-    lim = (Limits){0};
-    lim.depth = depth;
-
-    int64_t start = system_msec();
-
-    for (int i = 0; fens[i]; i++) {
-        pos_set(&rootPos, fens[i]);
-        zobrist_clear(&rootStack);
-        zobrist_push(&rootStack, rootPos.key);
-
-        puts(fens[i]);
-        nodes += search_go();
-        seal = hash(&nodes, sizeof nodes, seal);
-        puts("");
-    }
-
-    if (dbgCnt[0] || dbgCnt[1])
-        printf("dbgCnt[0] = %" PRId64 ", dbgCnt[1] = %" PRId64 "\n", dbgCnt[0], dbgCnt[1]);
-
-    const int64_t elapsed = system_msec() - start;
-
-    seal = hash(HashTable, HashCount * sizeof(HashEntry), seal);  // sign entire hash table
-
-    printf("seal  : %" PRIx64 "\n", seal);  // strong functionality signature
-    printf("time  : %" PRIu64 "ms\n", elapsed);
-    printf("nodes : %" PRIu64 "\n", nodes);  // total nodes = weak functionality signature
-    printf("nps   : %.0f\n", nodes * 1000.0 / max(elapsed, 1));  // avoid div/0
-}
-
 int main(int argc, char **argv)
 {
     eval_init();
@@ -78,11 +42,95 @@ int main(int argc, char **argv)
             if (argc > 4)
                 uciHash = 1ULL << bb_msb((uint64_t)atoll(argv[4]));  // must be a power of 2
 
+#ifdef TUNE
+            if (argc > 5 && !tune_load(argv[5])) {
+                printf("cannot read parameters: %s\n", argv[5]);
+                return EXIT_FAILURE;
+            }
+#endif
+
             workers_prepare(WorkersCount);
             hash_prepare(uciHash);
             bench(depth);
+        } else if (!strcmp(argv[1], "scaling")) {
+            const int depth = argc > 2 ? atoi(argv[2]) : 12;
+            const int maxThreads = max(argc > 3 ? atoi(argv[3]) : cpu_count(), 1);
+            const int runs = max(argc > 5 ? atoi(argv[5]) : 3, 1);
+
+            if (argc > 4)
+                uciHash = 1ULL << bb_msb((uint64_t)atoll(argv[4]));  // must be a power of 2
+
+            bench_scaling(depth, maxThreads, runs);
+        } else if (!strcmp(argv[1], "throughput")) {
+            const int depth = argc > 2 ? atoi(argv[2]) : 12;
+            const int procs = max(argc > 3 ? atoi(argv[3]) : cpu_count(), 1);
+            const size_t hashMB = argc > 4 ? (size_t)atoll(argv[4]) : (size_t)procs * uciHash;
+
+            bench_throughput(depth, procs, hashMB);
+        } else if (!strcmp(argv[1], "compare") && argc >= 4) {
+            const char *engines[2] = {argv[2], argv[3]};
+            const int runs = argc > 4 ? atoi(argv[4]) : 10;
+            const int depth = argc > 5 ? atoi(argv[5]) : 12;
+
+            bench_compare(engines, runs, depth);
+        } else if (!strcmp(argv[1], "latency") && argc >= 3) {
+            const int rounds = max(argc > 3 ? atoi(argv[3]) : 20, 1);
+            const int movetime = argc > 4 ? atoi(argv[4]) : 100;
+            const size_t hashMB = argc > 5 ? (size_t)1 << bb_msb((uint64_t)atoll(argv[5])) : 64;
+
+            bench_latency(argv[2], rounds, movetime, hashMB);
+        } else if (!strcmp(argv[1], "epd") && argc >= 3) {
+            const int64_t movetime = argc > 3 ? atoll(argv[3]) : 1000;
+            const uint64_t nodes = argc > 4 ? (uint64_t)atoll(argv[4]) : 0;
+
+            if (argc > 5)
+                WorkersCount = (size_t)atoll(argv[5]);
+
+            if (argc > 6)
+                uciHash = 1ULL << bb_msb((uint64_t)atoll(argv[6]));  // must be a power of 2
+
+            workers_prepare(WorkersCount);
+            hash_prepare(uciHash);
+
+            if (!epd_run(argv[2], movetime, nodes)) {
+                printf("cannot read EPD file: %s\n", argv[2]);
+                return EXIT_FAILURE;
+            }
+        } else if (!strcmp(argv[1], "features") && argc >= 5
+                && (!strcmp(argv[2], "halfkp") || !strcmp(argv[2], "halfka"))) {
+            const int set = !strcmp(argv[2], "halfka") ? HALFKA : HALFKP;
+            const long long batchSize = argc > 5 ? atoll(argv[5]) : 8192;
+
+            if (batchSize < 1) {
+                puts("batch size must be at least 1");
+                return EXIT_FAILURE;
+            }
+
+            if (!features_convert(argv[3], argv[4], set, (size_t)batchSize)) {
+                printf("cannot convert %s to %s\n", argv[3], argv[4]);
+                return EXIT_FAILURE;
+            }
+        } else if (!strcmp(argv[1], "trace") && argc >= 3) {
+            if (!trace_report(argc - 2, (const char **)&argv[2])) {
+                puts("cannot read trace files");
+                return EXIT_FAILURE;
+            }
+        } else if (!strcmp(argv[1], "microbench")) {
+            // Large enough hash table by default, so that cold hash accesses miss the LLC
+            uciHash = 1ULL << bb_msb((uint64_t)(argc > 2 ? atoll(argv[2]) : 256));
+
+            workers_prepare(1);
+            hash_prepare(uciHash);
+            microbench();
+        } else if (!strcmp(argv[1], "perft")) {
+            if (!perft_suite(argc > 2 ? atoi(argv[2]) : MAX_DEPTH))
+                return EXIT_FAILURE;
         } else
-            puts("Syntax: demolito [bench [depth [threads [hash]]]]");
+            puts("Syntax: demolito [bench [depth [threads [hash]]] | scaling [depth [threads [hash [runs]]]]\n"
+                "    | throughput [depth [procs [hash]]] | compare engine1[:params] engine2[:params] [runs [depth]]\n"
+                "    | latency engine [rounds [movetime [hash]]]\n"
+                "    | epd file [movetime [nodes [threads [hash]]]] | features halfkp|halfka input output [batch]\n"
+                "    | trace files... | microbench [hash] | perft [depth]]");
     } else {
         workers_prepare(WorkersCount);
         hash_prepare(uciHash);
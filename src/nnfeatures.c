@@ -0,0 +1,179 @@
+/*
+ * Demolito, a UCI chess engine. Copyright 2015-2020 lucasart.
+ *
+ * Demolito is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * Demolito is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program. If
+ * not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "bitboard.h"
+#include "nnfeatures.h"
+#include "platform.h"
+
+// Piece types per color: NBRQP (HALFKP), or NBRQKP (HALFKA)
+static const int PieceCount[NB_FEATURE_SET] = {5, 6};
+
+int features_size(int set)
+{
+    BOUNDS(set, NB_FEATURE_SET);
+    return NB_SQUARE * 2 * PieceCount[set] * NB_SQUARE;
+}
+
+int features_extract(const Position *pos, int set, int perspective, int32_t idx[MAX_ACTIVE])
+{
+    BOUNDS(set, NB_FEATURE_SET);
+    BOUNDS(perspective, NB_COLOR);
+
+    // Flip ranks for black, so that each side sees the board from its own side
+    const int flip = perspective == WHITE ? 0 : 56;
+    const int king = pos_king_square(pos, perspective) ^ flip;
+    const int n = PieceCount[set];
+    int cnt = 0;
+
+    for (int color = WHITE; color <= BLACK; color++)
+        for (int piece = KNIGHT; piece <= PAWN; piece++) {
+            if (piece == KING && set == HALFKP)
+                continue;
+
+            // Index of piece type: NBRQ[K]P for us, then the same for them
+            const int p = (piece == PAWN ? n - 1 : piece) + (color != perspective) * n;
+            bitboard_t b = pos_pieces_cp(pos, color, piece);
+
+            while (b) {
+                if (cnt == MAX_ACTIVE)
+                    return -1;
+
+                idx[cnt++] = (king * 2 * n + p) * NB_SQUARE + (bb_pop_lsb(&b) ^ flip);
+            }
+        }
+
+    return cnt;
+}
+
+typedef struct {
+    int32_t *us, *them, *stm, *score;
+    float *result;
+} Batch;
+
+static void write_batch(FILE *out, const Batch *b, int set, size_t cnt)
+{
+    const uint32_t header[3] = {(uint32_t)set, (uint32_t)cnt, MAX_ACTIVE};
+    fwrite("DMFB", 1, 4, out);
+    fwrite(header, sizeof(uint32_t), 3, out);
+    fwrite(b->us, sizeof(int32_t), cnt * MAX_ACTIVE, out);
+    fwrite(b->them, sizeof(int32_t), cnt * MAX_ACTIVE, out);
+    fwrite(b->stm, sizeof(int32_t), cnt, out);
+    fwrite(b->score, sizeof(int32_t), cnt, out);
+    fwrite(b->result, sizeof(float), cnt, out);
+}
+
+static void free_batch(Batch *b)
+{
+    free(b->us);
+    free(b->them);
+    free(b->stm);
+    free(b->score);
+    free(b->result);
+}
+
+bool features_convert(const char *in, const char *out, int set, size_t batchSize)
+{
+    if (batchSize < 1)
+        return false;
+
+    Batch b = {
+        .us = malloc(batchSize * MAX_ACTIVE * sizeof(int32_t)),
+        .them = malloc(batchSize * MAX_ACTIVE * sizeof(int32_t)),
+        .stm = malloc(batchSize * sizeof(int32_t)),
+        .score = malloc(batchSize * sizeof(int32_t)),
+        .result = malloc(batchSize * sizeof(float))
+    };
+
+    if (!b.us || !b.them || !b.stm || !b.score || !b.result) {
+        free_batch(&b);
+        return false;
+    }
+
+    FILE *fin = fopen(in, "r"), *fout = fopen(out, "wb");
+
+    if (!fin || !fout) {
+        if (fin)
+            fclose(fin);
+
+        if (fout)
+            fclose(fout);
+
+        free_batch(&b);
+        return false;
+    }
+
+    const int64_t start = system_msec();
+    char line[256];
+    size_t cnt = 0, total = 0;
+
+    while (fgets(line, sizeof line, fin)) {
+        // FEN (6 fields), then optional score and result
+        char fields[6][80];
+        int score = 0, n = 0;
+        float result = 0.5;
+
+        if (sscanf(line, "%79s %79s %79s %79s %79s %79s %n", fields[0], fields[1], fields[2],
+                fields[3], fields[4], fields[5], &n) != 6)
+            continue;
+
+        sscanf(line + n, "%d %f", &score, &result);
+
+        char fen[sizeof fields];  // 6 fields of up to 79 characters, 5 spaces, and '\0'
+        snprintf(fen, sizeof fen, "%s %s %s %s %s %s", fields[0], fields[1], fields[2], fields[3],
+            fields[4], fields[5]);
+
+        Position pos;
+        pos_set(&pos, fen);
+
+        int32_t *us = &b.us[cnt * MAX_ACTIVE], *them = &b.them[cnt * MAX_ACTIVE];
+        const int usCnt = features_extract(&pos, set, pos.turn, us);
+        const int themCnt = features_extract(&pos, set, opposite(pos.turn), them);
+
+        if (usCnt < 0 || themCnt < 0)
+            continue;
+
+        for (int i = usCnt; i < MAX_ACTIVE; i++)
+            us[i] = -1;
+
+        for (int i = themCnt; i < MAX_ACTIVE; i++)
+            them[i] = -1;
+
+        b.stm[cnt] = pos.turn;
+        b.score[cnt] = score;
+        b.result[cnt] = result;
+
+        if (++cnt == batchSize) {
+            write_batch(fout, &b, set, cnt);
+            total += cnt;
+            cnt = 0;
+        }
+    }
+
+    if (cnt) {
+        write_batch(fout, &b, set, cnt);
+        total += cnt;
+    }
+
+    const int64_t elapsed = system_msec() - start;
+    printf("positions: %zu\n", total);
+    printf("time     : %" PRId64 "ms (%.0f positions/s)\n", elapsed, total * 1000.0 / max(elapsed,
+        (int64_t)1));
+
+    free_batch(&b);
+    fclose(fin);
+    fclose(fout);
+    return true;
+}
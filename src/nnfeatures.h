@@ -0,0 +1,30 @@
+#pragma once
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "position.h"
+
+// Sparse NN input features, for external trainers. For each perspective (side to move, then the
+// other side), a position is encoded as the indices of its active features:
+// - HALFKP: (king square, piece, square) for each non-king piece, 64 x 10 x 64 = 40960 features.
+// - HALFKA: same, but kings are also pieces, 64 x 12 x 64 = 49152 features.
+// Squares are seen from the perspective (rank flipped for black), and pieces are ordered as ours
+// (NBRQ[K]P) then theirs: index = (king * 2 * n + piece) * 64 + square, where n = 5 (HALFKP) or 6
+// (HALFKA) piece types per color.
+enum {HALFKP, HALFKA, NB_FEATURE_SET};
+enum {MAX_ACTIVE = 32};  // maximum number of active features (per perspective)
+
+int features_size(int set);  // number of features (per perspective)
+
+// Returns the number of active features, or -1 if there are more than MAX_ACTIVE (invalid position)
+int features_extract(const Position *pos, int set, int perspective, int32_t idx[MAX_ACTIVE]);
+
+// Convert a file of FENs (one per line, optionally followed by a score in cp from the side to
+// move's pov, and a game result from white's pov: 1, 0.5, 0) into batches of features. Each batch
+// is written as (native endian, 4-byte fields):
+//   char magic[4] = "DMFB"; uint32 set, count N, maxActive K;
+//   int32 us[N][K], them[N][K];  // feature indices, padded with -1
+//   int32 stm[N], score[N]; float result[N];
+// Positions with too many pieces are skipped. Returns false if a file cannot be opened, batchSize
+// is 0, or memory cannot be allocated.
+bool features_convert(const char *in, const char *out, int set, size_t batchSize);
@@ -0,0 +1,135 @@
+/*
+ * Demolito, a UCI chess engine. Copyright 2015-2020 lucasart.
+ *
+ * Demolito is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * Demolito is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program. If
+ * not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include "perf.h"
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} Events[NB_PERF] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)}
+};
+
+void perf_open(PerfCounters *pc)
+{
+    for (int i = 0; i < NB_PERF; i++) {
+        // Counters are opened separately (not as a group), because 'inherit' does not support
+        // group reads. We need 'inherit' to count the search threads created by search_go().
+        struct perf_event_attr attr = {
+            .type = Events[i].type,
+            .size = sizeof(struct perf_event_attr),
+            .config = Events[i].config,
+            .read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING,
+            .disabled = 1,
+            .inherit = 1,
+            .exclude_kernel = 1,
+            .exclude_hv = 1
+        };
+
+        pc->fd[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        pc->count[i] = 0;
+    }
+}
+
+void perf_close(PerfCounters *pc)
+{
+    for (int i = 0; i < NB_PERF; i++)
+        if (pc->fd[i] >= 0) {
+            close(pc->fd[i]);
+            pc->fd[i] = -1;
+        }
+}
+
+void perf_start(PerfCounters *pc)
+{
+    for (int i = 0; i < NB_PERF; i++)
+        if (pc->fd[i] >= 0) {
+            ioctl(pc->fd[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(pc->fd[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+}
+
+void perf_stop(PerfCounters *pc)
+{
+    for (int i = 0; i < NB_PERF; i++)
+        if (pc->fd[i] >= 0) {
+            ioctl(pc->fd[i], PERF_EVENT_IOC_DISABLE, 0);
+
+            // value, time enabled, time running: scale up if the counter was multiplexed
+            uint64_t v[3];
+
+            if (read(pc->fd[i], v, sizeof v) == sizeof v && v[2])
+                pc->count[i] = (double)v[0] * v[1] / v[2];
+            else
+                pc->count[i] = 0;
+        }
+}
+#else
+void perf_open(PerfCounters *pc)
+{
+    for (int i = 0; i < NB_PERF; i++) {
+        pc->fd[i] = -1;
+        pc->count[i] = 0;
+    }
+}
+
+void perf_close(PerfCounters *pc) { (void)pc; }
+void perf_start(PerfCounters *pc) { (void)pc; }
+void perf_stop(PerfCounters *pc) { (void)pc; }
+#endif
+
+bool perf_available(const PerfCounters *pc)
+{
+    for (int i = 0; i < NB_PERF; i++)
+        if (pc->fd[i] >= 0)
+            return true;
+
+    return false;
+}
+
+void perf_print(const PerfCounters *pc, uint64_t nodes)
+{
+    if (!perf_available(pc)) {
+        puts("perf  : hardware counters unavailable");
+        return;
+    }
+
+    static const char *labels[NB_PERF] = {"cycles", "instructions", "branch-misses",
+        "L1D-misses", "LLC-misses", "dTLB-misses"};
+
+    // Search probes the hash table once per node, so X/node also reads as X/probe
+    for (int i = 0; i < NB_PERF; i++)
+        if (pc->fd[i] >= 0)
+            printf("%-14s: %.0f (%.3f/node)\n", labels[i], pc->count[i], pc->count[i] / nodes);
+        else
+            printf("%-14s: n/a\n", labels[i]);
+
+    if (pc->fd[PERF_CYCLES] >= 0 && pc->fd[PERF_INSTRUCTIONS] >= 0 && pc->count[PERF_CYCLES] > 0)
+        printf("%-14s: %.3f\n", "IPC", pc->count[PERF_INSTRUCTIONS] / pc->count[PERF_CYCLES]);
+}
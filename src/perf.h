@@ -0,0 +1,25 @@
+#pragma once
+#include <inttypes.h>
+#include <stdbool.h>
+
+// Hardware performance counters (Linux perf_event_open). Counters that cannot be opened (other OS,
+// virtual machine, perf_event_paranoid, etc.) are simply reported as unavailable.
+enum {
+    PERF_CYCLES, PERF_INSTRUCTIONS, PERF_BRANCH_MISSES, PERF_L1D_MISSES, PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    NB_PERF
+};
+
+typedef struct {
+    int fd[NB_PERF];  // -1 if unavailable
+    double count[NB_PERF];  // scaled for multiplexing, by perf_stop()
+} PerfCounters;
+
+void perf_open(PerfCounters *pc);
+void perf_close(PerfCounters *pc);
+bool perf_available(const PerfCounters *pc);
+
+void perf_start(PerfCounters *pc);  // reset and enable counting (for this thread and its children)
+void perf_stop(PerfCounters *pc);  // disable counting, and read counts
+
+void perf_print(const PerfCounters *pc, uint64_t nodes);
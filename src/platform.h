@@ -18,6 +18,12 @@
     // Threads
     #define sleep_msec(msec) Sleep(msec)
 
+    static inline int cpu_count(void) {
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        return (int)si.dwNumberOfProcessors;
+    }
+
     // Timer
     static inline int64_t system_msec(void) {
         LARGE_INTEGER t, f;
@@ -25,7 +31,16 @@
         QueryPerformanceFrequency(&f);
         return 1000LL * t.QuadPart / f.QuadPart;
     }
+
+    static inline int64_t system_nsec(void) {
+        LARGE_INTEGER t, f;
+        QueryPerformanceCounter(&t);
+        QueryPerformanceFrequency(&f);
+        return (int64_t)(1e9 * t.QuadPart / f.QuadPart);
+    }
 #else
+    #include <unistd.h>
+
     // Locks
     typedef pthread_mutex_t mtx_t;
     #define mtx_init(m, t) pthread_mutex_init(m, NULL)
@@ -37,10 +52,20 @@
     #define sleep_msec(msec) nanosleep(&(struct timespec){.tv_sec = msec / 1000, \
         .tv_nsec = (msec % 1000) * 1000000LL}, NULL)
 
+    static inline int cpu_count(void) {
+        return (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+
     // Timer
     static inline int64_t system_msec(void) {
         struct timespec t;
         clock_gettime(CLOCK_MONOTONIC, &t);
         return t.tv_sec * 1000LL + t.tv_nsec / 1000000;
     }
+
+    static inline int64_t system_nsec(void) {
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec * 1000000000LL + t.tv_nsec;
+    }
 #endif
@@ -14,16 +14,20 @@
 */
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include "eval.h"
 #include "htable.h"
 #include "position.h"
 #include "search.h"
 #include "sort.h"
+#include "trace.h"
 #include "uci.h"
 #include "workers.h"
 
 Position rootPos;
 ZobristStack rootStack;
+Position rootParent;  // position before rootLastMove
+move_t rootLastMove;  // last move played to reach rootPos (0 if none), used for pondering
 Limits lim;
 
 atomic_bool Stop;  // Stop signal raised by timer or master thread, and observed by workers
@@ -46,8 +50,41 @@ void search_init()
 
 static const int Tempo = 17;
 
-static int qsearch(Worker *worker, const Position *pos, int ply, int depth, int alpha, int beta,
-    bool pvNode, move_t pv[])
+// Fraction of the ponder search (before ponderhit) counted as time spent on this move
+static const double PonderCredit = 0.5;
+
+// Helper threads join the search only once the main worker has completed HelperDepth, or after a
+// delay: HelperDelayRatio of the allocated time, at most HelperDelay ms (also used without a time
+// limit). Most depth or node limited searches (datagen) are over by then, and the shallow iterations
+// of helpers would only compete with the main worker for HT lines and memory bandwidth. With a
+// clock, the helpers still get most of the (possibly very short) time allocated.
+static const int HelperDepth = 8;
+static const int64_t HelperDelay = 20;
+static const double HelperDelayRatio = 0.05;
+
+// With the Private Hash option, qsearch and non PV nodes up to this depth go to the worker's private
+// table instead of the shared one, to save write traffic on shared cache lines (many threads).
+static const int PrivateHashDepth = 1;
+
+// Search functions are specialized by node type at compile time: search_node() and qsearch_node()
+// are always inlined, with constant flags, into the wrappers below. This way, the non PV nodes (the
+// vast majority) do not test for PV or root node conditions. Calls are dispatched by the wrappers
+// search() and qsearch(), which fold into direct calls when the node type is known statically.
+
+static int qsearch_pv(Worker *worker, const Position *pos, int ply, int depth, int alpha, int beta,
+    move_t pv[]);
+static int qsearch_nonpv(Worker *worker, const Position *pos, int ply, int depth, int alpha,
+    int beta, move_t pv[]);
+
+static inline int qsearch(Worker *worker, const Position *pos, int ply, int depth, int alpha,
+    int beta, bool pvNode, move_t pv[])
+{
+    return pvNode ? qsearch_pv(worker, pos, ply, depth, alpha, beta, pv)
+        : qsearch_nonpv(worker, pos, ply, depth, alpha, beta, pv);
+}
+
+static inline __attribute__((always_inline)) int qsearch_node(Worker *worker, const Position *pos,
+    int ply, int depth, int alpha, int beta, const bool pvNode, move_t pv[])
 {
     assert(depth <= 0);
     assert(zobrist_back(&worker->stack) == pos->key);
@@ -70,14 +107,19 @@ static int qsearch(Worker *worker, const Position *pos, int ply, int depth, int
     if (ply > 0 && (zobrist_repetition(&worker->stack, pos) || pos_insufficient_material(pos)))
         return draw_score(ply);
 
-    // HT probe
+    // HT probe: private table first (see PrivateHashDepth), then the shared one
     HashEntry he;
     int refinedEval;
+    STAT_INC(worker, qsProbes);
+
+    if ((uciPrivateHash && qhash_read(worker->qhash, pos->key, &he, ply))
+            || hash_read(pos->key, &he, ply)) {
+        STAT_INC(worker, qsHits);
 
-    if (hash_read(pos->key, &he, ply)) {
         if (!pvNode && ((he.score <= alpha && he.bound >= EXACT)
                 || (he.score >= beta && he.bound <= EXACT))) {
             assert(he.depth >= depth);
+            STAT_INC(worker, qsTTCutoffs);
             return he.score;
         }
 
@@ -94,6 +136,7 @@ static int qsearch(Worker *worker, const Position *pos, int ply, int depth, int
     }
 
     worker->nodes++;
+    STAT_INC(worker, qnodes);
 
     if (ply >= MAX_PLY)
         return refinedEval;
@@ -190,13 +233,43 @@ static int qsearch(Worker *worker, const Position *pos, int ply, int depth, int
     he.eval = pos->checkers ? -MATE : worker->eval[ply];
     he.depth = 0;
     he.move = bestMove;
-    hash_write(pos->key, &he, ply);
+
+    if (uciPrivateHash)
+        qhash_write(worker->qhash, pos->key, &he, ply);
+    else
+        hash_write(pos->key, &he, ply);
 
     return bestScore;
 }
 
-static int search(Worker *worker, const Position *pos, int ply, int depth, int alpha, int beta,
-    move_t pv[], move_t singularMove)
+static __attribute__((noinline)) int qsearch_pv(Worker *worker, const Position *pos, int ply,
+    int depth, int alpha, int beta, move_t pv[])
+{
+    return qsearch_node(worker, pos, ply, depth, alpha, beta, true, pv);
+}
+
+static __attribute__((noinline)) int qsearch_nonpv(Worker *worker, const Position *pos, int ply,
+    int depth, int alpha, int beta, move_t pv[])
+{
+    return qsearch_node(worker, pos, ply, depth, alpha, beta, false, pv);
+}
+
+static int search_pv(Worker *worker, const Position *pos, int ply, int depth, int alpha, int beta,
+    move_t pv[], move_t singularMove);
+static int search_nonpv(Worker *worker, const Position *pos, int ply, int depth, int alpha,
+    int beta, move_t pv[], move_t singularMove);
+
+// PV nodes are those searched with an open window
+static inline int search(Worker *worker, const Position *pos, int ply, int depth, int alpha,
+    int beta, move_t pv[], move_t singularMove)
+{
+    return beta > alpha + 1 ? search_pv(worker, pos, ply, depth, alpha, beta, pv, singularMove)
+        : search_nonpv(worker, pos, ply, depth, alpha, beta, pv, singularMove);
+}
+
+static inline __attribute__((always_inline)) int search_node(Worker *worker, const Position *pos,
+    int ply, int depth, int alpha, int beta, move_t pv[], move_t singularMove, const bool pvNode,
+    const bool rootNode)
 {
     static const int EvalMargin[] = {0, 130, 264, 410, 510, 672, 840};
     static const int RazorMargin[] = {0, 229, 438, 495, 878, 1094};
@@ -208,8 +281,8 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
     assert(depth > 0);
     assert(zobrist_back(&worker->stack) == pos->key);
     assert(-MATE <= alpha && alpha < beta && beta <= MATE);
+    assert(pvNode == (beta > alpha + 1) && rootNode == !ply);
 
-    const bool pvNode = beta > alpha + 1;
     const int oldAlpha = alpha;
     const int us = pos->turn;
     int bestScore = -MATE;
@@ -217,25 +290,35 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
     int score;
     Position nextPos;
 
-    if (atomic_load_explicit(&Stop, memory_order_relaxed))
+    // Only alternate workers (multi-reply pondering) can be redirected: others skip that load
+    if (atomic_load_explicit(&Stop, memory_order_relaxed) || (worker->alternate
+            && atomic_load_explicit(&worker->redirect, memory_order_relaxed)))
         longjmp(worker->jbuf, 1);
 
     // Allocate PV for the child node, and terminate current PV
     move_t childPv[MAX_PLY - ply];
     pv[0] = 0;
 
-    if (ply > 0 && (zobrist_repetition(&worker->stack, pos) || pos_insufficient_material(pos)))
+    if (!rootNode && (zobrist_repetition(&worker->stack, pos) || pos_insufficient_material(pos))) {
+        TRACE_DECISION(worker, TRACE_DRAW);
         return draw_score(ply);
+    }
 
     // HT probe
     HashEntry he;
     int refinedEval;
     const uint64_t key = pos->key ^ singularMove;
+    STAT_INC(worker, ttProbes);
+
+    if (hash_read(key, &he, ply) || (uciPrivateHash && qhash_read(worker->qhash, key, &he, ply))) {
+        STAT_INC(worker, ttHits);
 
-    if (hash_read(key, &he, ply)) {
         if (he.depth >= depth && !pvNode && ((he.score <= alpha && he.bound >= EXACT)
-                || (he.score >= beta && he.bound <= EXACT)))
+                || (he.score >= beta && he.bound <= EXACT))) {
+            STAT_INC(worker, ttCutoffs);
+            TRACE_DECISION(worker, TRACE_TT_CUT);
             return he.score;
+        }
 
         refinedEval = worker->eval[ply] = he.eval;
 
@@ -245,37 +328,52 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
     } else {
         he.data = 0;  // invalidate hash entry
         refinedEval = worker->eval[ply] = pos->checkers ? -MATE
-           : zobrist_move_key(&worker->stack, 0) == ZobristTurn ? -worker->eval[ply - 1] + 2 * Tempo
+           : !rootNode && zobrist_move_key(&worker->stack, 0) == ZobristTurn
+               ? -worker->eval[ply - 1] + 2 * Tempo
            : evaluate(worker, pos) + Tempo;
     }
 
     // At Root, ensure that the last best move is searched first. This is not guaranteed,
     // as the HT entry could have got overriden by other search threads.
-    if (ply == 0 && info_last_depth(&ui) > 0)
+    if (rootNode && !worker->alternate && info_last_depth(&ui) > 0)
         he.move = info_best(&ui);
 
     worker->nodes++;
+    STAT_INC(worker, nodes);
 
-    if (ply >= MAX_PLY)
+    if (ply >= MAX_PLY) {
+        TRACE_DECISION(worker, TRACE_MAX_PLY);
         return refinedEval;
+    }
 
     // Eval pruning
     if (depth <= 6 && !pos->checkers && !pvNode && pos->pieceMaterial[us]
-            && refinedEval >= beta + EvalMargin[depth])
+            && refinedEval >= beta + EvalMargin[depth]) {
+        STAT_INC(worker, evalPruned);
+        TRACE_DECISION(worker, TRACE_EVAL_PRUNED);
         return refinedEval;
+    }
 
     // Razoring
     if (depth <= 5 && !pos->checkers && !singularMove && !pvNode) {
         const int lbound = alpha - RazorMargin[depth];
 
         if (refinedEval <= lbound) {
-            if (depth <= 2)
+            STAT_INC(worker, razorTries);
+
+            if (depth <= 2) {
+                STAT_INC(worker, razorCutoffs);
+                TRACE_DECISION(worker, TRACE_RAZORED);
                 return qsearch(worker, pos, ply, 0, alpha, alpha + 1, false, childPv);
+            }
 
             score = qsearch(worker, pos, ply, 0, lbound, lbound + 1, false, childPv);
 
-            if (score <= lbound)
+            if (score <= lbound) {
+                STAT_INC(worker, razorCutoffs);
+                TRACE_DECISION(worker, TRACE_RAZORED);
                 return score;
+            }
         }
     }
 
@@ -289,6 +387,8 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
 
         pos_switch(&nextPos, pos);
         zobrist_push(&worker->stack, nextPos.key);
+        STAT_INC(worker, nullTries);
+        TRACE_CALL(worker, TRACE_NULL_MOVE, 0, 0);
 
         score = nextDepth <= 0
             ? -qsearch(worker, &nextPos, ply + 1, nextDepth, -beta, -(beta - 1), false, childPv)
@@ -296,8 +396,11 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
 
         zobrist_pop(&worker->stack);
 
-        if (score >= beta)
+        if (score >= beta) {
+            STAT_INC(worker, nullCutoffs);
+            TRACE_DECISION(worker, TRACE_NULL_CUT);
             return score >= mate_in(MAX_PLY) ? beta : score;
+        }
     }
 
     // Generate and score moves
@@ -353,13 +456,16 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
         // Search extension
         int ext = 0;
 
-        if (currentMove == he.move && ply > 0 && depth >= 5 && he.bound <= EXACT && he.depth >= depth - 4) {
+        if (currentMove == he.move && !rootNode && depth >= 5 && he.bound <= EXACT && he.depth >= depth - 4) {
             // Singular Extension Search
             const int lbound = he.score - 2 * depth;
 
             if (abs(lbound) < MATE) {
+                TRACE_CALL(worker, TRACE_SINGULAR, currentMove, 0);
                 score = search(worker, pos, ply, depth - 4, lbound, lbound + 1, childPv, currentMove);
                 ext = score <= lbound;
+                STAT_INC(worker, singularTries);
+                STAT_ADD(worker, singularExtensions, ext);
             }
         } else
             // Check extension
@@ -374,9 +480,10 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
             score = -qsearch(worker, &nextPos, ply + 1, nextDepth, -beta, -alpha, pvNode, childPv);
         else {
             // Search recursion (PVS + Reduction)
-            if (moveCount == 1)
+            if (moveCount == 1) {
+                TRACE_CALL(worker, TRACE_FIRST, currentMove, 0);
                 score = -search(worker, &nextPos, ply + 1, nextDepth, -beta, -alpha, childPv, 0);
-            else {
+            } else {
                 int reduction = see < 0 || !capture;
 
                 if (!capture) {
@@ -390,17 +497,27 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
                 }
 
                 // Reduced depth, zero window
+                TRACE_CALL(worker, reduction ? TRACE_REDUCED : TRACE_ZERO_WINDOW, currentMove,
+                    reduction);
                 score = nextDepth - reduction <= 0
                     ? -qsearch(worker, &nextPos, ply + 1, nextDepth - reduction, -(alpha + 1), -alpha, false, childPv)
                     : -search(worker, &nextPos, ply + 1, nextDepth - reduction, -(alpha + 1), -alpha, childPv, 0);
 
+                if (reduction)
+                    STAT_INC(worker, lmrSearches);
+
                 // Fail high: re-search zero window at full depth
-                if (reduction && score > alpha)
+                if (reduction && score > alpha) {
+                    STAT_INC(worker, lmrResearches);
+                    TRACE_CALL(worker, TRACE_LMR_RESEARCH, currentMove, 0);
                     score = -search(worker, &nextPos, ply + 1, nextDepth, -(alpha + 1), -alpha, childPv, 0);
+                }
 
                 // Fail high at full depth for pvNode: re-search full window
-                if (pvNode && alpha < score && score < beta)
+                if (pvNode && alpha < score && score < beta) {
+                    TRACE_CALL(worker, TRACE_PV_RESEARCH, currentMove, 0);
                     score = -search(worker, &nextPos, ply + 1, nextDepth, -beta, -alpha, childPv, 0);
+                }
             }
         }
 
@@ -425,7 +542,7 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
 
                     // Best move has changed since last completed iteration. Update the best move and
                     // PV immediately, because we may not have time to finish this iteration.
-                    if (ply == 0 && moveCount > 1 && depth > 1)
+                    if (rootNode && moveCount > 1 && depth > 1 && !worker->alternate)
                         info_update(&ui, depth, score, workers_nodes(), pv, true);
                 }
             }
@@ -433,15 +550,26 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
     }
 
     // No legal move: mated or stalemated
-    if (!moveCount)
+    if (!moveCount) {
+        TRACE_DECISION(worker, TRACE_NO_MOVE);
         return singularMove ? alpha : pos->checkers ? mated_in(ply) : draw_score(ply);
+    }
 
     // Return worst possible score when all moves are pruned
     if (bestScore <= -MATE) {
         assert(bestScore == -MATE);
+        TRACE_DECISION(worker, TRACE_ALL_PRUNED);
         return max(alpha, mated_in(ply + 1));
     }
 
+#ifdef STATS
+    // Fail high rate on the first move measures move ordering
+    if (bestScore >= beta && !singularMove) {
+        STAT_INC(worker, failHigh[min(depth, STATS_DEPTH - 1)]);
+        STAT_ADD(worker, failHighFirst[min(depth, STATS_DEPTH - 1)], moveCount == 1);
+    }
+#endif
+
     // Update move sorting statistics
     if (alpha > oldAlpha && !singularMove && !pos_move_is_capture(pos, bestMove)) {
         const size_t rhIdx = zobrist_move_key(&worker->stack, 0) % NB_REFUTATION;
@@ -451,9 +579,9 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
             const int bonus = quietSearched[i] == bestMove ? depth * depth : -1 - depth * depth / 2;
             const int from = move_from(quietSearched[i]), to = move_to(quietSearched[i]);
 
-            history_update(&worker->history[us][from][to], bonus);
-            history_update(&worker->refutationHistory[rhIdx][pos->pieceOn[from]][to], bonus);
-            history_update(&worker->followUpHistory[fuhIdx][pos->pieceOn[from]][to], bonus);
+            history_update(&worker->history->butterfly[us][from][to], bonus);
+            history_update(&worker->history->refutation[rhIdx][pos->pieceOn[from]][to], bonus);
+            history_update(&worker->history->followUp[fuhIdx][pos->pieceOn[from]][to], bonus);
         }
     }
 
@@ -463,24 +591,74 @@ static int search(Worker *worker, const Position *pos, int ply, int depth, int a
     he.eval = pos->checkers ? -MATE : worker->eval[ply];
     he.depth = depth;
     he.move = bestMove;
-    hash_write(key, &he, ply);
 
+    if (uciPrivateHash && !pvNode && depth <= PrivateHashDepth)
+        qhash_write(worker->qhash, key, &he, ply);
+    else
+        hash_write(key, &he, ply);
+
+    TRACE_DECISION(worker, TRACE_SEARCHED);
     return bestScore;
 }
 
+// Trace builds record each node on exit (see trace.h). Nodes interrupted by longjmp() are lost.
+static inline __attribute__((always_inline)) int search_traced(Worker *worker,
+    const Position *pos, int ply, int depth, int alpha, int beta, move_t pv[], move_t singularMove,
+    const bool pvNode, const bool rootNode)
+{
+#ifdef TRACE
+    const TraceState call = worker->trace;  // set by the parent (TRACE_CALL)
+    const uint64_t nodes = worker->nodes;
+
+    const int score = search_node(worker, pos, ply, depth, alpha, beta, pv, singularMove, pvNode,
+        rootNode);
+
+    trace_write((int)(worker - Workers), &(TraceRecord){
+        .subtree = worker->nodes - nodes, .alpha = (int16_t)alpha, .beta = (int16_t)beta,
+        .score = (int16_t)score, .move = call.move, .ply = (int8_t)ply, .depth = (int8_t)depth,
+        .type = rootNode ? TRACE_ROOT_NODE : pvNode ? TRACE_PV_NODE : TRACE_NON_PV_NODE,
+        .context = rootNode ? TRACE_ROOT : call.context, .decision = worker->trace.decision,
+        .reduction = call.reduction
+    });
+
+    return score;
+#else
+    return search_node(worker, pos, ply, depth, alpha, beta, pv, singularMove, pvNode, rootNode);
+#endif
+}
+
+static __attribute__((noinline)) int search_pv(Worker *worker, const Position *pos, int ply,
+    int depth, int alpha, int beta, move_t pv[], move_t singularMove)
+{
+    return search_traced(worker, pos, ply, depth, alpha, beta, pv, singularMove, true, false);
+}
+
+static __attribute__((noinline)) int search_nonpv(Worker *worker, const Position *pos, int ply,
+    int depth, int alpha, int beta, move_t pv[], move_t singularMove)
+{
+    return search_traced(worker, pos, ply, depth, alpha, beta, pv, singularMove, false, false);
+}
+
+// Root node: called once per aspiration window, so the window type is resolved at runtime
+static int search_root(Worker *worker, int depth, int alpha, int beta, move_t pv[])
+{
+    return search_traced(worker, &worker->root, 0, depth, alpha, beta, pv, 0, beta > alpha + 1,
+        true);
+}
+
 static int aspirate(Worker *worker, int depth, move_t pv[], int score)
 {
     assert(depth > 0);
 
     if (depth == 1)
-        return search(worker, &rootPos, 0, depth, -MATE, MATE, pv, 0);
+        return search_root(worker, depth, -MATE, MATE, pv);
 
     int delta = 15;
     int alpha = max(score - delta, -MATE);
     int beta = min(score + delta, MATE);
 
     for ( ; ; delta *= 1.876) {
-        score = search(worker, &rootPos, 0, depth, alpha, beta, pv, 0);
+        score = search_root(worker, depth, alpha, beta, pv);
 
         if (score <= alpha) {
             beta = (alpha + beta) / 2;
@@ -497,17 +675,41 @@ void *iterate(void *_worker)
 {
     Worker *worker = _worker;
     move_t pv[MAX_PLY + 1];
-    int volatile score = 0;
+    int volatile score = worker->completedDepth ? worker->bestScore : 0;
+
+    // Start after the last completed iteration: normally 0, unless the previous search is reused
+    for (volatile int depth = worker->completedDepth + 1; depth <= lim.depth; depth++) {
+#ifdef STATS
+        const uint64_t iterStart = worker->nodes;
+#endif
+        worker->depth = depth;
 
-    for (volatile int depth = 1; depth <= lim.depth; depth++) {
         if (!setjmp(worker->jbuf))
             score = aspirate(worker, depth, pv, score);
         else {
             worker->stack.idx = rootStack.idx;  // Restore stack position
-            break;
+
+            if (!worker->redirect || Stop)
+                break;
+
+            // Ponderhit: alternate worker switches to the real root, and restarts from depth 1
+            worker->root = rootPos;
+            worker->stack = rootStack;
+            worker->alternate = worker->redirect = false;
+            worker->completedDepth = 0;
+            worker->pv[0] = 0;
+            depth = score = 0;
+            continue;
         }
 
-        info_update(&ui, depth, score, workers_nodes(), pv, false);
+        STAT_ADD(worker, iterNodes[min(depth, STATS_DEPTH - 1)], worker->nodes - iterStart);
+
+        worker->completedDepth = depth;
+        worker->bestScore = score;
+        memcpy(worker->pv, pv, sizeof pv);
+
+        if (!worker->alternate)
+            info_update(&ui, depth, score, workers_nodes(), pv, false);
     }
 
     // Max depth completed by current thread. All threads should stop. Unless we are in infinite
@@ -534,6 +736,254 @@ bool is_mate_score(int score)
     return abs(score) >= MATE - MAX_PLY;
 }
 
+// Rank the opponent's replies from rootParent, for multi-reply pondering: the predicted reply
+// (rootLastMove) first, then the others by hash table score, best for the opponent first.
+static int ponder_replies(move_t replies[], int k)
+{
+    move_t mList[MAX_MOVES];
+    int scores[MAX_MOVES], cnt = 0;
+
+    const bitboard_t pins = calc_pins(&rootParent);
+    const move_t *end = gen_all_moves(&rootParent, mList);
+
+    for (const move_t *m = mList; m != end; m++)
+        if (*m != rootLastMove && gen_is_legal(&rootParent, pins, *m)) {
+            Position nextPos;
+            HashEntry he;
+            pos_move(&nextPos, &rootParent, *m);
+
+            // Rank by depth first: the previous search explored the main alternatives deeper,
+            // while it refuted the others quickly. Score is from our point of view.
+            const int depth = hash_read(nextPos.key, &he, 1) ? he.depth : -1;
+            mList[cnt] = *m;
+            scores[cnt++] = depth * (2 * MATE + 1) - (depth >= 0 ? he.score : 0);
+        }
+
+    replies[0] = rootLastMove;
+    k = min(k, cnt + 1);
+
+    // Partial selection sort: pick the best remaining reply, and put the first one in its place
+    for (int i = 1; i < k; i++) {
+        int best = i - 1;
+
+        for (int j = i; j < cnt; j++)
+            if (scores[j] > scores[best])
+                best = j;
+
+        replies[i] = mList[best];
+        mList[best] = mList[i - 1];
+        scores[best] = scores[i - 1];
+    }
+
+    return k;
+}
+
+// Divide workers across the most likely replies, so that on a ponder miss, the real position is
+// already warm in the (shared) hash table. Worker 0 always searches the predicted reply. Returns
+// the number of replies k: worker i is an alternate worker iff i % k != 0.
+static int ponder_split(void)
+{
+    move_t replies[MAX_MOVES];
+    const int k = ponder_replies(replies, min(uciPonderReplies, (int)WorkersCount));
+
+    for (size_t i = 0; i < WorkersCount; i++)
+        if (i % (size_t)k) {
+            Worker *w = &Workers[i];
+            pos_move(&w->root, &rootParent, replies[i % (size_t)k]);
+            zobrist_pop(&w->stack);
+            zobrist_push(&w->stack, w->root.key);
+            w->alternate = true;
+        }
+
+    return k;
+}
+
+// Choose the best move by a vote of all workers, weighted by completed depth and score. Helpers
+// that completed deeper iterations than the last one published in ui are thus taken into account.
+// Only completed iterations vote, so that each move is weighted by its own score.
+static void vote_best_move(void)
+{
+    int minScore = MATE;
+
+    for (size_t i = 0; i < WorkersCount; i++)
+        if (Workers[i].completedDepth && !Workers[i].alternate)
+            minScore = min(minScore, Workers[i].bestScore);
+
+    const Worker *bestWorker = NULL;
+    int64_t bestVotes = 0;
+
+    for (size_t i = 0; i < WorkersCount; i++) {
+        const Worker *w = &Workers[i];
+
+        if (!w->completedDepth || w->alternate || !w->pv[0])
+            continue;
+
+        int64_t votes = 0;
+
+        for (size_t j = 0; j < WorkersCount; j++)
+            if (Workers[j].completedDepth && !Workers[j].alternate
+                    && Workers[j].pv[0] == w->pv[0])
+                votes += (int64_t)(Workers[j].bestScore - minScore + 20)
+                    * Workers[j].completedDepth;
+
+        // Among the workers voting for the same move, prefer the deepest one (for its ponder move)
+        if (votes > bestVotes
+                || (votes == bestVotes && w->completedDepth > bestWorker->completedDepth)) {
+            bestVotes = votes;
+            bestWorker = w;
+        }
+    }
+
+    if (bestWorker)
+        info_vote(&ui, bestWorker->completedDepth, bestWorker->bestScore, workers_nodes(),
+            bestWorker->pv);
+}
+
+// Previous search, from the position predicted by its PV (after our best move and the expected
+// reply). If this position arrives, we continue from there, rather than restarting from depth 1
+// and relying only on what survived in the HT.
+static struct {
+    uint64_t key;  // predicted position (0 = none)
+    int depth, score;  // remaining depth of the PV below the predicted position
+    move_t pv[MAX_PLY + 1];
+} prev;
+
+// Lag between our bestmove and the GUI's clock (GUI, pipes, OS scheduling, network): the decrease
+// of our clock reported by the GUI, minus the time we measured ourselves. Sampled across consecutive
+// moves of a game, it calibrates the time buffer of clock searches, with the Time Buffer option as
+// a floor. A movetime search is not on a clock, so it only uses the option.
+enum {NB_LAG_SAMPLES = 16, NB_LAG_MIN = 4};
+
+static struct {
+    uint64_t key;  // root of our previous timed search (0 = none)
+    int idx;  // its rootStack.idx
+    int64_t time, inc, think;  // clock and increment at the previous go, and time we used
+    int64_t samples[NB_LAG_SAMPLES];
+    int cnt;
+    int64_t estimate;
+} lag;
+
+void search_clear()
+{
+    prev.key = lag.key = 0;
+    lag.cnt = 0;
+    lag.estimate = 0;
+}
+
+static int64_t time_buffer(void)
+{
+    // Our previous search was 2 plies ago, in the same game
+    if (lag.key && (lim.time || lim.inc) && rootStack.idx == lag.idx + 2
+            && rootStack.keys[lag.idx - 1] == lag.key) {
+        const int64_t sample = lag.time + lag.inc - lim.time - lag.think;
+
+        // Slightly negative: clock rounding. Out of range: time control reset (movestogo), GUI
+        // pause, or clock not tracked by the GUI. Discard those.
+        if (-100 <= sample && sample <= 250) {
+            lag.samples[lag.cnt++ % NB_LAG_SAMPLES] = max(sample, (int64_t)0);
+
+            // Robust estimate: 90th percentile of the last samples (ignores a rare outlier). Not
+            // trusted until there are enough samples.
+            const int n = min(lag.cnt, (int)NB_LAG_SAMPLES);
+            int64_t sorted[NB_LAG_SAMPLES];
+
+            for (int i = 0; i < n; i++) {
+                int j = i;
+
+                for ( ; j > 0 && sorted[j - 1] > lag.samples[i]; j--)
+                    sorted[j] = sorted[j - 1];
+
+                sorted[j] = lag.samples[i];
+            }
+
+            const int64_t estimate = n >= NB_LAG_MIN ? sorted[(n - 1) * 9 / 10] : 0;
+
+            if (estimate != lag.estimate) {
+                char str[80];
+                snprintf(str, sizeof str, "Time Buffer: measured lag %" PRId64 " ms, using %" PRId64
+                    " ms", estimate, max(uciTimeBuffer, estimate + 10));
+                info_string(str);
+            }
+
+            lag.estimate = estimate;
+        }
+    }
+
+    lag.key = 0;
+
+    // Plus 10ms: the timer loop checks every 5ms, and threads must still be joined
+    return lag.estimate && !lim.movetime ? max(uciTimeBuffer, lag.estimate + 10) : uciTimeBuffer;
+}
+
+// Remember a timed search, for the next lag sample
+static void lag_record(int64_t clockStart)
+{
+    if (!lim.movetime && (lim.time || lim.inc) && (!lim.ponder || lim.ponderhit)) {
+        lag.key = rootPos.key;
+        lag.idx = rootStack.idx;
+        lag.time = lim.time;
+        lag.inc = lim.inc;
+        lag.think = system_msec() - clockStart;
+    }
+}
+
+static void remember_search(void)
+{
+    // Deepest completed PV that agrees with the reported best move (if any)
+    const Worker *w = NULL;
+
+    for (size_t i = 0; i < WorkersCount; i++)
+        if (!Workers[i].alternate && Workers[i].completedDepth && Workers[i].pv[0] == ui.best
+                && (!w || Workers[i].completedDepth > w->completedDepth))
+            w = &Workers[i];
+
+    prev.key = 0;
+
+    if (!w || w->completedDepth < 4 || !w->pv[1] || !w->pv[2])
+        return;
+
+    Position p1, p2;
+    pos_move(&p1, &rootPos, w->pv[0]);
+    pos_move(&p2, &p1, w->pv[1]);
+
+    prev.key = p2.key;
+    prev.depth = w->completedDepth - 2;
+    prev.score = w->bestScore;
+
+    for (int i = 0; i < MAX_PLY - 1 && (prev.pv[i] = w->pv[i + 2]); i++);
+}
+
+// The predicted position arrived: seed the iterations before prev.depth as completed, so that the
+// PV is searched first (see info_best() at the root), and a move is available immediately. At least
+// one iteration is still searched. Returns the seeded depth (0 = no reuse).
+static int reuse_search(void)
+{
+    if (!prev.key || prev.key != rootPos.key)
+        return 0;
+
+    const int depth = min(prev.depth - 1, lim.depth - 1);
+
+    if (depth > 0)
+        info_seed(&ui, depth, prev.pv);
+
+    return max(depth, 0);
+}
+
+static void start_workers(pthread_t threads[], size_t first, size_t last, int reuseDepth)
+{
+    for (size_t i = first; i < last; i++) {
+        Worker *w = &Workers[i];
+
+        if (reuseDepth && !w->alternate) {
+            w->completedDepth = reuseDepth;
+            w->bestScore = prev.score;
+            memcpy(w->pv, prev.pv, sizeof prev.pv);
+        }
+
+        pthread_create(&threads[i], NULL, (void*(*)(void*))iterate, w);
+    }
+}
+
 uint64_t search_go()
 {
     int64_t start = system_msec();
@@ -545,42 +995,96 @@ uint64_t search_go()
     pthread_t threads[WorkersCount];
     workers_new_search();
 
+    // Heartbeat telemetry: nodes of each worker at the last beat, to compute its current NPS
+    uint64_t beatNodes[WorkersCount];
+    memset(beatNodes, 0, sizeof beatNodes);
+    int64_t lastBeat = start;
+
+    int replies = lim.ponder && uciPonderReplies > 1 && rootLastMove ? ponder_split() : 1;
+    const bool split = replies > 1;
+
+    const int reuseDepth = reuse_search();
+    const int64_t timeBuffer = time_buffer();
+
     int minTime = 0, maxTime = 0;  // Silence bogus gcc warning (maybe uninitialized)
 
     if (!lim.movetime && (lim.time || lim.inc)) {
         const int movesToGo = lim.movestogo ? lim.movestogo : 26;
         const int remaining = (movesToGo - 1) * lim.inc + lim.time;
 
-        minTime = min(0.57 * remaining / movesToGo, lim.time - uciTimeBuffer);
-        maxTime = min(2.21 * remaining / movesToGo, lim.time - uciTimeBuffer);
+        minTime = min(0.57 * remaining / movesToGo, lim.time - timeBuffer);
+        maxTime = min(2.21 * remaining / movesToGo, lim.time - timeBuffer);
     }
 
-    for (size_t i = 0; i < WorkersCount; i++)
-        // Start searching thread
-        pthread_create(&threads[i], NULL, (void*(*)(void*))iterate, &Workers[i]);
+    // Pondering: the time allocated is unknown until ponderhit
+    const int64_t allocated = lim.ponder ? 0 : lim.movetime ? lim.movetime - timeBuffer : minTime;
+    const int64_t helperDelay = allocated > 0 ? min(HelperDelay, (int64_t)(HelperDelayRatio
+        * allocated)) : HelperDelay;
+
+    // Start searching threads: only the main worker for now, unless pondering alternate replies
+    size_t started = split ? WorkersCount : 1;
+    start_workers(threads, 0, started, reuseDepth);
 
     do {
         sleep_msec(5);
 
+        if (started < WorkersCount && !Stop && (Workers[0].completedDepth >= HelperDepth
+                || system_msec() - start >= helperDelay)) {
+            start_workers(threads, started, WorkersCount, reuseDepth);
+            started = WorkersCount;
+        }
+
+        // Ponderhit: alternate workers join the search of the real position. Found by index, as
+        // alternate is only accessed by its own worker while searching.
+        if (replies > 1 && atomic_load(&lim.ponderhit)) {
+            for (size_t i = 0; i < WorkersCount; i++)
+                if (i % (size_t)replies)
+                    Workers[i].redirect = true;
+
+            replies = 1;
+        }
+
+        if (uciHeartbeat && system_msec() - lastBeat >= uciHeartbeat) {
+            const int64_t now = system_msec();
+            info_heartbeat(&ui, beatNodes, now - lastBeat);
+            lastBeat = now;
+        }
+
         // Check for search termination conditions, but only after depth 1 has been
         // completed, to make sure we do not return an illegal move.
         if (!lim.infinite && info_last_depth(&ui) > 0) {
-            if ((lim.movetime && system_msec() - start >= lim.movetime - uciTimeBuffer)
+            // After a ponderhit, our clock started running at ponderhit, not at the start of the
+            // (ponder) search. The ponder search was done on the right position, so part of it is
+            // credited, which turns pondering into saved clock time.
+            const int64_t clockStart = lim.ponder ? atomic_load(&lim.ponderhit) : start;
+            const int64_t used = system_msec() - clockStart;
+
+            if ((lim.movetime && used >= lim.movetime - timeBuffer)
                     || (lim.nodes && workers_nodes() >= lim.nodes))
                 atomic_store_explicit(&Stop, true, memory_order_release);
             else if (lim.time || lim.inc) {
                 const double x = 1 / (1 + exp(-info_variability(&ui)));
                 const int64_t t = x * maxTime + (1 - x) * minTime;
 
-                if (system_msec() - start >= t)
+                if (used + PonderCredit * (clockStart - start) >= t || used >= maxTime)
                     atomic_store_explicit(&Stop, true, memory_order_release);
             }
         }
     } while (!atomic_load_explicit(&Stop, memory_order_acquire));
 
-    for (size_t i = 0; i < WorkersCount; i++)
+    for (size_t i = 0; i < started; i++)
         pthread_join(threads[i], NULL);
 
+    stats_collect();
+    trace_flush();
+
+    if (WorkersCount > 1)
+        vote_best_move();
+
+    remember_search();
+
+    // Before bestmove: the GUI may then send the next position, while we are still here
+    lag_record(lim.ponder ? atomic_load(&lim.ponderhit) : start);
     info_print_bestmove(&ui);
     info_destroy(&ui);
 
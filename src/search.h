@@ -13,6 +13,8 @@ typedef struct {
     uint64_t nodes;
     int depth, movestogo;
     atomic_bool infinite;  // IO thread can change this while Timer thread is checking it
+    bool ponder;  // started with 'go ponder'
+    atomic_int_least64_t ponderhit;  // time of ponderhit (0 = not yet), set by IO thread
 } Limits;
 
 int mated_in(int ply);
@@ -23,8 +25,11 @@ extern atomic_bool Stop;  // set this to true to stop the search
 
 extern Position rootPos;
 extern ZobristStack rootStack;
+extern Position rootParent;
+extern move_t rootLastMove;
 extern Limits lim;
 extern int Contempt;
 
 void search_init(void);
+void search_clear(void);  // forget the previous search (new game)
 uint64_t search_go(void);
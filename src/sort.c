@@ -50,6 +50,7 @@ void sort_score(Worker *worker, Sort *sort, const Position *pos, move_t ttMove)
 {
     const size_t rhIdx = zobrist_move_key(&worker->stack, 0) % NB_REFUTATION;
     const size_t fuhIdx = zobrist_move_key(&worker->stack, 1) % NB_FOLLOW_UP;
+    const History *h = worker->history;
 
     for (size_t i = 0; i < sort->cnt; i++) {
         const move_t m = sort->moves[i];
@@ -62,25 +63,28 @@ void sort_score(Worker *worker, Sort *sort, const Position *pos, move_t ttMove)
                 sort->scores[i] = see >= 0 ? see + SEPARATION : see - SEPARATION;
             } else {
                 const int from = move_from(m), to = move_to(m);
-                sort->scores[i] = worker->history[pos->turn][from][to]
-                    + worker->refutationHistory[rhIdx][pos->pieceOn[from]][to]
-                    + worker->followUpHistory[fuhIdx][pos->pieceOn[from]][to];
+                const int piece = pos->pieceOn[from];
+                sort->scores[i] =
+                    atomic_load_explicit(&h->butterfly[pos->turn][from][to], memory_order_relaxed)
+                    + atomic_load_explicit(&h->refutation[rhIdx][piece][to], memory_order_relaxed)
+                    + atomic_load_explicit(&h->followUp[fuhIdx][piece][to], memory_order_relaxed);
             }
         }
     }
 }
 
-void history_update(int16_t *t, int bonus)
+void history_update(history_t *t, int bonus)
 {
     // Do all calculations on 32-bit, and only convert back to 16-bits once we are certain that
-    // there can be no overflow (signed int overflow is undefined in C).
-    int v = *t;
+    // there can be no overflow (signed int overflow is undefined in C). With shared history, the
+    // load/store pair is not atomic: concurrent updates can be lost, which is harmless.
+    int v = atomic_load_explicit(t, memory_order_relaxed);
 
     v += 32 * bonus - v * abs(bonus) / 128;
     v = min(v, HISTORY_MAX);  // cap
     v = max(v, -HISTORY_MAX);  // floor
 
-    *t = v;
+    atomic_store_explicit(t, (int_least16_t)v, memory_order_relaxed);
 }
 
 void sort_init(Worker *worker, Sort *sort, const Position *pos, int depth, move_t ttMove)
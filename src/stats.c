@@ -0,0 +1,99 @@
+/*
+ * Demolito, a UCI chess engine. Copyright 2015-2020 lucasart.
+ *
+ * Demolito is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * Demolito is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program. If
+ * not, see <http://www.gnu.org/licenses/>.
+*/
+#ifdef STATS
+#include <math.h>
+#include <stdio.h>
+#include "stats.h"
+#include "util.h"
+#include "workers.h"
+
+static Stats Total;
+
+void stats_clear()
+{
+    Total = (Stats){0};
+}
+
+void stats_collect()
+{
+    // Stats is only made of uint64_t counters, so it can be summed as an array
+    enum {N = sizeof(Stats) / sizeof(uint64_t)};
+
+    for (size_t i = 0; i < WorkersCount; i++) {
+        const uint64_t *src = (const uint64_t *)&Workers[i].stats;
+        uint64_t *dst = (uint64_t *)&Total;
+
+        for (size_t j = 0; j < N; j++)
+            dst[j] += src[j];
+
+        Workers[i].stats = (Stats){0};
+    }
+}
+
+void stats_print()
+{
+    const Stats *s = &Total;
+
+    puts("\nsearch statistics");
+    printf("%-20s: %" PRIu64 " search, %" PRIu64 " qsearch (%.2f qnodes/node)\n", "nodes",
+        s->nodes, s->qnodes, ratio(s->qnodes, s->nodes));
+    printf("%-20s: %.2f%% hits, %.2f%% cutoffs\n", "hash table (search)",
+        100 * ratio(s->ttHits, s->ttProbes), 100 * ratio(s->ttCutoffs, s->ttProbes));
+    printf("%-20s: %.2f%% hits, %.2f%% cutoffs\n", "hash table (qsearch)",
+        100 * ratio(s->qsHits, s->qsProbes), 100 * ratio(s->qsTTCutoffs, s->qsProbes));
+    printf("%-20s: %.2f%% hits\n", "pawn hash", 100 * ratio(s->pawnHits, s->pawnProbes));
+    printf("%-20s: %" PRIu64 " (%.2f%% of nodes)\n", "eval pruning", s->evalPruned,
+        100 * ratio(s->evalPruned, s->nodes));
+    printf("%-20s: %" PRIu64 " cutoffs / %" PRIu64 " tries (%.2f%%)\n", "razoring",
+        s->razorCutoffs, s->razorTries, 100 * ratio(s->razorCutoffs, s->razorTries));
+    printf("%-20s: %" PRIu64 " cutoffs / %" PRIu64 " tries (%.2f%%)\n", "null move",
+        s->nullCutoffs, s->nullTries, 100 * ratio(s->nullCutoffs, s->nullTries));
+    printf("%-20s: %" PRIu64 " re-searches / %" PRIu64 " reduced (%.2f%%)\n", "LMR",
+        s->lmrResearches, s->lmrSearches, 100 * ratio(s->lmrResearches, s->lmrSearches));
+    printf("%-20s: %" PRIu64 " extended / %" PRIu64 " tries (%.2f%%)\n", "singular extension",
+        s->singularExtensions, s->singularTries,
+        100 * ratio(s->singularExtensions, s->singularTries));
+
+    // Fail high on first move rate (move ordering quality), and effective branching factor
+    puts("depth   fail-high  first-move%   iter-nodes     EBF");
+    double logEbf = 0;
+    int first = 0, last = 0;
+
+    for (int d = 1; d < STATS_DEPTH; d++) {
+        if (!s->failHigh[d] && !s->iterNodes[d])
+            continue;
+
+        const double ebf = ratio(s->iterNodes[d], s->iterNodes[d - 1]);
+        printf("%5d %11" PRIu64 " %12.2f %12" PRIu64, d, s->failHigh[d],
+            100 * ratio(s->failHighFirst[d], s->failHigh[d]), s->iterNodes[d]);
+
+        if (ebf > 0) {
+            printf(" %7.2f", ebf);
+
+            if (!first)
+                first = d;
+
+            last = d;
+            logEbf += log(ebf);
+        }
+
+        puts("");
+    }
+
+    if (first)
+        printf("%-20s: %.3f (geometric mean, depth %d to %d)\n", "EBF",
+            exp(logEbf / (last - first + 1)), first, last);
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+#include <inttypes.h>
+
+// Search statistics, compiled in only with -DSTATS (see 'make stats'). Each worker increments its
+// own counters (no sharing, no atomics), which are merged into a global total after each search.
+// In release builds, STAT_INC() expands to nothing, and the Stats struct is not even part of Worker.
+
+enum {STATS_DEPTH = 32};  // depth buckets (last one also counts deeper nodes)
+
+typedef struct {
+    uint64_t nodes, qnodes;  // search() and qsearch() nodes
+    uint64_t ttProbes, ttHits, ttCutoffs, qsProbes, qsHits, qsTTCutoffs, pawnProbes, pawnHits;
+    uint64_t evalPruned, razorTries, razorCutoffs, nullTries, nullCutoffs;
+    uint64_t lmrSearches, lmrResearches, singularTries, singularExtensions;
+    uint64_t failHigh[STATS_DEPTH], failHighFirst[STATS_DEPTH];  // beta cutoffs, on 1st move
+    uint64_t iterNodes[STATS_DEPTH];  // nodes spent on each completed iteration
+} Stats;
+
+#ifdef STATS
+    #define STAT_INC(worker, counter) ((worker)->stats.counter++)
+    #define STAT_ADD(worker, counter, value) ((worker)->stats.counter += (uint64_t)(value))
+
+    void stats_clear(void);
+    void stats_collect(void);  // merge worker counters into the global total, and reset them
+    void stats_print(void);
+#else
+    #define STAT_INC(worker, counter) ((void)0)
+    #define STAT_ADD(worker, counter, value) ((void)0)
+
+    static inline void stats_clear(void) {}
+    static inline void stats_collect(void) {}
+    static inline void stats_print(void) {}
+#endif
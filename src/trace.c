@@ -0,0 +1,192 @@
+/*
+ * Demolito, a UCI chess engine. Copyright 2015-2020 lucasart.
+ *
+ * Demolito is free software: you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License as published by the Free Software Foundation, either version 3 of the
+ * License, or (at your option) any later version.
+ *
+ * Demolito is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without
+ * even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along with this program. If
+ * not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "trace.h"
+#include "util.h"
+
+#ifdef TRACE
+#include "workers.h"
+
+enum {TRACE_BUFFER = 1 << 16};  // records per worker (1.5MB)
+
+typedef struct {
+    FILE *out;
+    size_t cnt;
+    TraceRecord buf[TRACE_BUFFER];
+} TraceWriter;
+
+static TraceWriter *Writers[256];  // one per worker (max Threads)
+
+static void writer_flush(TraceWriter *w)
+{
+    fwrite(w->buf, sizeof(TraceRecord), w->cnt, w->out);
+    w->cnt = 0;
+}
+
+void trace_write(int worker, const TraceRecord *r)
+{
+    // Each worker only uses its own writer, opened on first use: no locking needed
+    TraceWriter *w = Writers[worker];
+
+    if (!w) {
+        char fileName[32];
+        snprintf(fileName, sizeof fileName, "trace-%d.bin", worker);
+        w = Writers[worker] = calloc(1, sizeof(TraceWriter));
+
+        if (!w || !(w->out = fopen(fileName, "wb"))) {
+            fprintf(stderr, "trace_write(): cannot write %s\n", fileName);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    w->buf[w->cnt++] = *r;
+
+    if (w->cnt == TRACE_BUFFER)
+        writer_flush(w);
+}
+
+void trace_flush()
+{
+    for (size_t i = 0; i < sizeof(Writers) / sizeof(*Writers); i++)
+        if (Writers[i]) {
+            writer_flush(Writers[i]);
+            fflush(Writers[i]->out);
+        }
+}
+
+static void __attribute__((destructor)) trace_close(void)
+{
+    trace_flush();
+
+    for (size_t i = 0; i < sizeof(Writers) / sizeof(*Writers); i++)
+        if (Writers[i]) {
+            fclose(Writers[i]->out);
+            free(Writers[i]);
+        }
+}
+#endif
+
+enum {REPORT_DEPTH = 12};  // depth buckets (last one also counts deeper nodes)
+
+typedef struct {
+    uint64_t count, subtree;
+} Bucket;
+
+static void print_bucket(const char *label, const Bucket *b, uint64_t nodes)
+{
+    printf("%-20s %12" PRIu64 " %14" PRIu64 " %8.2f%% %12.1f\n", label, b->count, b->subtree,
+        100 * ratio(b->subtree, nodes), ratio(b->subtree, b->count));
+}
+
+// Subtree sizes by pruning decision and by search context, to find where search() spends its nodes
+bool trace_report(int count, const char *fileNames[])
+{
+    static const char *Contexts[NB_TRACE_CONTEXT] = {"root", "first move", "zero window",
+        "reduced (LMR)", "LMR re-search", "PV re-search", "null move", "singular"};
+    static const char *Decisions[NB_TRACE_DECISION] = {"searched", "draw", "HT cutoff", "max ply",
+        "eval pruning", "razoring", "null move cutoff", "no move", "all moves pruned"};
+
+    Bucket contexts[NB_TRACE_CONTEXT] = {{0}}, decisions[NB_TRACE_DECISION] = {{0}};
+    Bucket failLow = {0}, exact = {0}, failHigh = {0}, wasted = {0};
+    uint64_t byDepth[REPORT_DEPTH][NB_TRACE_DECISION] = {{0}}, failHighDepth[REPORT_DEPTH] = {0};
+    uint64_t nodes = 0, records = 0;
+
+    for (int i = 0; i < count; i++) {
+        FILE *in = fopen(fileNames[i], "rb");
+
+        if (!in)
+            return false;
+
+        TraceRecord r;
+
+        while (fread(&r, sizeof r, 1, in) == 1) {
+            if (r.context >= NB_TRACE_CONTEXT || r.decision >= NB_TRACE_DECISION)
+                continue;
+
+            records++;
+
+            if (r.context == TRACE_ROOT)
+                nodes += r.subtree;
+
+            contexts[r.context].count++;
+            contexts[r.context].subtree += r.subtree;
+            decisions[r.decision].count++;
+            decisions[r.decision].subtree += r.subtree;
+
+            const int d = r.depth < 1 ? 1 : r.depth < REPORT_DEPTH ? r.depth : REPORT_DEPTH - 1;
+            byDepth[d][r.decision]++;
+
+            if (r.decision == TRACE_SEARCHED) {
+                Bucket *b = r.score <= r.alpha ? &failLow : r.score >= r.beta ? &failHigh : &exact;
+                b->count++;
+                b->subtree += r.subtree;
+                failHighDepth[d] += r.score >= r.beta;
+            }
+
+            // A reduced search that fails high (low for the child) is re-searched at full depth:
+            // its whole subtree was spent for nothing.
+            if (r.context == TRACE_REDUCED && r.score <= r.alpha) {
+                wasted.count++;
+                wasted.subtree += r.subtree;
+            }
+        }
+
+        fclose(in);
+    }
+
+    printf("%" PRIu64 " records, %" PRIu64 " nodes (including qsearch)\n\n", records, nodes);
+    // Subtrees are nested (eg. a reduced search contains first moves), so nodes% do not add up
+    printf("%-20s %12s %14s %9s %12s\n", "", "count", "subtree", "nodes%", "avg subtree");
+
+    puts("by context:");
+
+    for (int c = 0; c < NB_TRACE_CONTEXT; c++)
+        print_bucket(Contexts[c], &contexts[c], nodes);
+
+    print_bucket("wasted reduced", &wasted, nodes);
+
+    puts("by decision:");
+
+    for (int d = 0; d < NB_TRACE_DECISION; d++)
+        print_bucket(Decisions[d], &decisions[d], nodes);
+
+    print_bucket("- fail low", &failLow, nodes);
+    print_bucket("- exact", &exact, nodes);
+    print_bucket("- fail high", &failHigh, nodes);
+
+    // Pruning rates per depth, to tune the margins (EvalMargin, RazorMargin, etc.)
+    puts("\ndepth      nodes  HT-cut%   eval%  razor%   null%  searched  fail-high%");
+
+    for (int d = 1; d < REPORT_DEPTH; d++) {
+        uint64_t total = 0;
+
+        for (int i = 0; i < NB_TRACE_DECISION; i++)
+            total += byDepth[d][i];
+
+        if (!total)
+            continue;
+
+        printf("%4d%s %10" PRIu64 " %8.2f %7.2f %7.2f %7.2f %9" PRIu64 " %11.2f\n", d,
+            d == REPORT_DEPTH - 1 ? "+" : " ", total,
+            100 * ratio(byDepth[d][TRACE_TT_CUT], total),
+            100 * ratio(byDepth[d][TRACE_EVAL_PRUNED], total),
+            100 * ratio(byDepth[d][TRACE_RAZORED], total),
+            100 * ratio(byDepth[d][TRACE_NULL_CUT], total),
+            byDepth[d][TRACE_SEARCHED], 100 * ratio(failHighDepth[d], byDepth[d][TRACE_SEARCHED]));
+    }
+
+    return true;
+}
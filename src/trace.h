@@ -0,0 +1,67 @@
+#pragma once
+#include <inttypes.h>
+#include <stdbool.h>
+#include "types.h"
+
+// Search tree trace, compiled in only with -DTRACE (see 'make trace'). Each search() node writes one
+// record on exit, to the file trace-<worker>.bin (buffered per worker). qsearch() nodes are not
+// recorded, but are included in the subtree size of their search() parent. Records are read back by
+// trace_report(), which is available in all builds ('demolito trace files...').
+
+// Why a node was searched: set by the parent, before calling search()
+enum {
+    TRACE_ROOT,
+    TRACE_FIRST,  // first move (full window)
+    TRACE_ZERO_WINDOW,  // later move, zero window, unreduced
+    TRACE_REDUCED,  // later move, zero window, reduced (LMR)
+    TRACE_LMR_RESEARCH,  // re-search at full depth after a reduced search failed high
+    TRACE_PV_RESEARCH,  // re-search with full window after a zero window search failed high
+    TRACE_NULL_MOVE,
+    TRACE_SINGULAR,  // singular extension verification (excluding the HT move)
+    NB_TRACE_CONTEXT
+};
+
+// How the node returned: before the move loop (pruning), or after it (search result)
+enum {
+    TRACE_SEARCHED,  // move loop completed (fail low, exact, or fail high: compare score/bounds)
+    TRACE_DRAW,  // repetition or insufficient material
+    TRACE_TT_CUT,
+    TRACE_MAX_PLY,
+    TRACE_EVAL_PRUNED,
+    TRACE_RAZORED,
+    TRACE_NULL_CUT,
+    TRACE_NO_MOVE,  // mate, stalemate, or no alternative to the singular move
+    TRACE_ALL_PRUNED,  // every move was pruned
+    NB_TRACE_DECISION
+};
+
+enum {TRACE_ROOT_NODE, TRACE_PV_NODE, TRACE_NON_PV_NODE};
+
+typedef struct {
+    uint64_t subtree;  // nodes searched below (and including) this node
+    int16_t alpha, beta, score;
+    move_t move;  // move leading to this node (0 = root or null move, excluded move if singular)
+    int8_t ply, depth;
+    uint8_t type, context, decision, reduction;
+} TraceRecord;
+
+typedef struct {
+    move_t move;
+    uint8_t context, decision, reduction;
+} TraceState;
+
+#ifdef TRACE
+    #define TRACE_CALL(worker, ctx, m, r) ((worker)->trace = (TraceState){.move = (m), \
+        .context = (ctx), .reduction = (uint8_t)(r)})
+    #define TRACE_DECISION(worker, d) ((worker)->trace.decision = (d))
+
+    void trace_write(int worker, const TraceRecord *r);
+    void trace_flush(void);  // write out all buffers (end of search)
+#else
+    #define TRACE_CALL(worker, ctx, m, r) ((void)0)
+    #define TRACE_DECISION(worker, d) ((void)0)
+
+    static inline void trace_flush(void) {}
+#endif
+
+bool trace_report(int count, const char *fileNames[]);
@@ -185,6 +185,25 @@ void tune_parse(const char *fullName, int value)
             ((int *)Entries[i].values)[idx] = value;
 }
 
+// Load parameters from a file of 'name value' lines (eg. 'PieceValue_0 640')
+bool tune_load(const char *fileName)
+{
+    FILE *in = fopen(fileName, "r");
+
+    if (!in)
+        return false;
+
+    char name[NAME_MAX_CHAR];
+    int value;
+
+    while (fscanf(in, "%63s %d", name, &value) == 2)
+        tune_parse(name, value);
+
+    fclose(in);
+    tune_refresh();
+    return true;
+}
+
 void tune_refresh()
 {
     search_init();
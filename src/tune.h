@@ -30,4 +30,5 @@ extern int FreePasser[4];
 
 void tune_declare(void);
 void tune_parse(const char *fullName, int value);
+bool tune_load(const char *fileName);
 void tune_refresh(void);
@@ -23,6 +23,7 @@
 #include "search.h"
 #include "tune.h"
 #include "uci.h"
+#include "util.h"
 
 #define uci_printf(...) printf(__VA_ARGS__), fflush(stdout)
 #define uci_puts(str) puts(str), fflush(stdout)
@@ -32,6 +33,12 @@ static pthread_t Timer = 0;
 size_t uciHash = 2;
 int64_t uciTimeBuffer = 60;
 bool uciChess960 = false;
+bool uciQuiet = false;  // suppress search output (info and bestmove), eg. for benchmarks
+int64_t uciHeartbeat = 0;  // period (ms) of heartbeat info lines during search (0 = disabled)
+int uciPonderReplies = 1;  // number of opponent replies searched when pondering (multi-threaded)
+bool uciSharedHistory = false;  // all workers share the same history tables (instead of private)
+bool uciPrivateHash = false;  // qsearch and depth 1 nodes use the worker's private table (qhash)
+char uciMetricsFile[256] = "";  // heartbeat also rewrites this file (Prometheus text format)
 
 static void uci_format_score(int score, char str[17])
 {
@@ -45,8 +52,15 @@ static void intro(void)
 {
     uci_puts("id name Demolito " VERSION "\nid author lucasart");
     uci_printf("option name Contempt type spin default %d min -100 max 100\n", Contempt);
-    uci_printf("option name Hash type spin default %zu min 1 max 1048576\n", uciHash);
+    uci_printf("option name Hash type spin default %zu min 0 max 1048576\n", uciHash);
+    uci_printf("option name Heartbeat type spin default %" PRId64 " min 0 max 60000\n", uciHeartbeat);
+    uci_puts("option name Metrics File type string default <empty>");
     uci_puts("option name Ponder type check default false");
+    uci_printf("option name Ponder Replies type spin default %d min 1 max 8\n", uciPonderReplies);
+    uci_printf("option name Private Hash type check default %s\n",
+        uciPrivateHash ? "true" : "false");
+    uci_printf("option name Shared History type check default %s\n",
+        uciSharedHistory ? "true" : "false");
     uci_printf("option name Threads type spin default %zu min 1 max 256\n", WorkersCount);
     uci_printf("option name Time Buffer type spin default %" PRId64 " min 0 max 1000\n", uciTimeBuffer);
     uci_printf("option name UCI_Chess960 type check default %s\n", uciChess960 ? "true" : "false");
@@ -72,15 +86,45 @@ static void setoption(char **linePos)
     if (!strcmp(name, "UCI_Chess960"))
         uciChess960 = !strcmp(token, "true");
     else if (!strcmp(name, "Hash")) {
-        uciHash = (size_t)atoll(token);
-        uciHash = 1ULL << bb_msb(uciHash);  // must be a power of two
-        hash_prepare(uciHash);
+        // 0 (or "auto"): choose from available memory, including container (cgroup) limits
+        if (!(uciHash = (size_t)atoll(token))) {
+            uint64_t availableMB, cgroupMB;
+            uciHash = hash_auto(&availableMB, &cgroupMB);
+
+            char cgroup[32] = "none";
+
+            if (cgroupMB)
+                snprintf(cgroup, sizeof cgroup, "%" PRIu64 " MB", cgroupMB);
+
+            uci_printf("info string Hash auto: available %" PRIu64 " MB, cgroup limit %s, using %zu"
+                " MB\n", availableMB, cgroup, uciHash);
+        }
+
+        const size_t requested = uciHash = 1ULL << bb_msb(uciHash);  // must be a power of two
+
+        // Keep what the engine has learned so far: an analyst may grow the hash mid-session
+        if ((uciHash = hash_resize(uciHash)) < requested)
+            uci_printf("info string Hash: cannot allocate %zu MB, using %zu MB\n", requested,
+                uciHash);
     } else if (!strcmp(name, "Threads"))
         workers_prepare((size_t)atoll(token));
     else if (!strcmp(name, "Contempt"))
         Contempt = atoi(token);
     else if (!strcmp(name, "TimeBuffer"))
         uciTimeBuffer = atoi(token);
+    else if (!strcmp(name, "PonderReplies"))
+        uciPonderReplies = atoi(token);
+    else if (!strcmp(name, "PrivateHash"))
+        uciPrivateHash = !strcmp(token, "true");
+    else if (!strcmp(name, "SharedHistory")) {
+        uciSharedHistory = !strcmp(token, "true");
+        workers_clear();  // point workers to the right tables (clears history)
+    }
+    else if (!strcmp(name, "Heartbeat"))
+        uciHeartbeat = atoll(token);
+    else if (!strcmp(name, "MetricsFile"))
+        snprintf(uciMetricsFile, sizeof uciMetricsFile, "%s",
+            !token || !strcmp(token, "<empty>") ? "" : token);
     else {
 #ifdef TUNE
         tune_parse(name, atoi(token));
@@ -108,11 +152,14 @@ static void position(char **linePos)
     pos_set(&pos[idx], fen);
     zobrist_clear(&rootStack);
     zobrist_push(&rootStack, pos[idx].key);
+    rootLastMove = 0;
 
     // Parse moves (if any)
     while ((token = strtok_r(NULL, " \n", linePos))) {
         move_t m = pos_string_to_move(&pos[idx], token);
         pos_move(&pos[idx^1], &pos[idx], m);
+        rootParent = pos[idx];
+        rootLastMove = m;
         idx ^= 1;
         zobrist_push(&rootStack, pos[idx].key);
     }
@@ -142,8 +189,10 @@ static void go(char **linePos)
         else if ((rootPos.turn == WHITE && !strcmp(token, "winc"))
                 || (rootPos.turn == BLACK && !strcmp(token, "binc")))
             lim.inc = atoll(strtok_r(NULL, " \n", linePos));
-        else if (!strcmp(token, "infinite") || !strcmp(token, "ponder"))
+        else if (!strcmp(token, "infinite"))
             lim.infinite = true;
+        else if (!strcmp(token, "ponder"))
+            lim.infinite = lim.ponder = true;
     }
 
     if (Timer) {
@@ -184,9 +233,9 @@ void uci_loop()
         else if (!strcmp(token, "isready"))
             uci_puts("readyok");
         else if (!strcmp(token, "ucinewgame")) {
-            memset(HashTable, 0, uciHash << 20);
+            hash_new_epoch();
             workers_clear();
-            hashDate = 0;
+            search_clear();
 #ifdef TUNE
             tune_refresh();
 #endif
@@ -197,8 +246,11 @@ void uci_loop()
         else if (!strcmp(token, "stop")) {
             lim.infinite = false;
             Stop = true;
-        } else if (!strcmp(token, "ponderhit"))
-            lim.infinite = false;  // switch from pondering to normal search
+        } else if (!strcmp(token, "ponderhit")) {
+            // Switch from pondering to normal search. Our clock is running from now on.
+            lim.ponderhit = system_msec();
+            lim.infinite = false;
+        }
         else if (!strcmp(token, "d"))
             pos_print(&rootPos);
         else if (!strcmp(token, "eval"))
@@ -224,6 +276,8 @@ void info_create(Info *info)
     info->variability = 0.5;
     info->best = info->ponder = 0;
     info->start = system_msec();
+    info->bestTime = 0;
+    info->bestNodes = 0;
     mtx_init(&info->mtx, mtx_plain);
 }
 
@@ -232,32 +286,51 @@ void info_destroy(Info *info)
     mtx_destroy(&info->mtx);
 }
 
+static void info_print(const Info *info, int depth, int score, uint64_t nodes, const move_t pv[])
+{
+    // Print info line all the way to the "pv" token
+    char str[17];
+    uci_format_score(score, str);
+    const int64_t time = system_msec() - info->start;
+    uci_printf("info depth %d score %s time %" PRId64 " nodes %" PRIu64 " nps %" PRIu64
+        " hashfull %d pv", depth, str, time, nodes, nodes * 1000 / (uint64_t)max(time, 1),
+        hash_permille());
+
+    // Pring the moves. Because of e1g1 notation when Chess960 = false, we need to play the PV
+    // to print it correctly. This is a design flaw of the UCI protocol, which should have
+    // encoded castling as e1h1 regardless of Chess960 allowing coherent treatement.
+    Position pos[NB_COLOR];
+    int idx = 0;
+    pos[idx] = rootPos;
+
+    for (int i = 0; pv[i]; i++) {
+        pos_move_to_string(&pos[idx], pv[i], str);
+        uci_printf(" %s", str);
+        pos_move(&pos[idx ^ 1], &pos[idx], pv[i]);
+        idx ^= 1;
+    }
+
+    uci_puts("");
+}
+
+// Seed a completed depth and its PV (eg. from a reused search): nothing is printed, as nothing was
+// searched, and the best move variability is unchanged.
+void info_seed(Info *info, int depth, const move_t pv[])
+{
+    mtx_lock(&info->mtx);
+    info->lastDepth = depth;
+    info->best = pv[0];
+    info->ponder = pv[1];
+    mtx_unlock(&info->mtx);
+}
+
 void info_update(Info *info, int depth, int score, uint64_t nodes, move_t pv[], bool partial)
 {
     mtx_lock(&info->mtx);
 
     if (depth > info->lastDepth) {
-        // Print info line all the way to the "pv" token
-        char str[17];
-        uci_format_score(score, str);
-        uci_printf("info depth %d score %s time %" PRId64 " nodes %" PRIu64 " hashfull %d pv",
-            depth, str, system_msec() - info->start, nodes, hash_permille());
-
-        // Pring the moves. Because of e1g1 notation when Chess960 = false, we need to play the PV
-        // to print it correctly. This is a design flaw of the UCI protocol, which should have
-        // encoded castling as e1h1 regardless of Chess960 allowing coherent treatement.
-        Position pos[NB_COLOR];
-        int idx = 0;
-        pos[idx] = rootPos;
-
-        for (int i = 0; pv[i]; i++) {
-            pos_move_to_string(&pos[idx], pv[i], str);
-            uci_printf(" %s", str);
-            pos_move(&pos[idx ^ 1], &pos[idx], pv[i]);
-            idx ^= 1;
-        }
-
-        uci_puts("");
+        if (!uciQuiet)
+            info_print(info, depth, score, nodes, pv);
 
         // Update variability depending on whether the bestmove has changed or is confirmed
         // - changed: increase variability (rescale for %age of partial updates = f(threads))
@@ -266,6 +339,12 @@ void info_update(Info *info, int depth, int score, uint64_t nodes, move_t pv[],
             ? 0.6 * pow(WorkersCount, -0.08)
             : -0.24 * !partial;
 
+        // Remember when the best move appeared, for time to solution in test suites
+        if (info->best != pv[0]) {
+            info->bestTime = system_msec() - info->start;
+            info->bestNodes = nodes;
+        }
+
         if (!partial)
             info->lastDepth = depth;
 
@@ -276,8 +355,109 @@ void info_update(Info *info, int depth, int score, uint64_t nodes, move_t pv[],
     mtx_unlock(&info->mtx);
 }
 
+// Search is over: the SMP vote chose pv[0]. Print its info line, unless it was the last one printed,
+// so that the score and PV match the bestmove.
+void info_vote(Info *info, int depth, int score, uint64_t nodes, const move_t pv[])
+{
+    mtx_lock(&info->mtx);
+
+    if (pv[0] != info->best || pv[1] != info->ponder) {
+        if (!uciQuiet)
+            info_print(info, depth, score, nodes, pv);
+
+        if (info->best != pv[0]) {
+            info->bestTime = system_msec() - info->start;
+            info->bestNodes = nodes;
+        }
+
+        info->best = pv[0];
+        info->ponder = pv[1];
+    }
+
+    mtx_unlock(&info->mtx);
+}
+
+// Rewrite the whole metrics file atomically (write + rename), so that a scraper never reads it
+// half written.
+static void write_metrics(const uint64_t threadNps[], int64_t time, uint64_t nodes, int hashfull)
+{
+    char tmpName[sizeof(uciMetricsFile) + 4];
+    snprintf(tmpName, sizeof tmpName, "%s.tmp", uciMetricsFile);
+    FILE *out = fopen(tmpName, "w");
+
+    if (!out)
+        return;
+
+    fprintf(out, "demolito_search_time_ms %" PRId64 "\n", time);
+    fprintf(out, "demolito_nodes_total %" PRIu64 "\n", nodes);
+    fprintf(out, "demolito_nps %" PRIu64 "\n", nodes * 1000 / (uint64_t)max(time, 1));
+    fprintf(out, "demolito_hashfull_permille %d\n", hashfull);
+
+    for (size_t i = 0; i < WorkersCount; i++) {
+        const Worker *w = &Workers[i];
+        fprintf(out, "demolito_thread_depth{thread=\"%zu\"} %d\n", i, w->depth);
+        fprintf(out, "demolito_thread_nodes_total{thread=\"%zu\"} %" PRIu64 "\n", i, w->nodes);
+        fprintf(out, "demolito_thread_nps{thread=\"%zu\"} %" PRIu64 "\n", i, threadNps[i]);
+#ifdef STATS
+        fprintf(out, "demolito_thread_pawn_hit_ratio{thread=\"%zu\"} %.4f\n", i,
+            ratio(w->stats.pawnHits, w->stats.pawnProbes));
+#endif
+    }
+
+    fclose(out);
+    rename(tmpName, uciMetricsFile);
+}
+
+// Periodic report during search (called by the timer loop), so that stalled or throttled workers
+// show up in long analysis. Per-thread NPS is measured since the previous beat. Worker counters are
+// read without synchronization: they may be slightly stale, which is fine for telemetry.
+void info_heartbeat(Info *info, uint64_t beatNodes[], int64_t elapsed)
+{
+    const int64_t time = system_msec() - info->start;
+    const uint64_t nodes = workers_nodes();
+    const int hashfull = hash_permille();
+    uint64_t threadNps[WorkersCount];
+
+    for (size_t i = 0; i < WorkersCount; i++) {
+        const uint64_t n = Workers[i].nodes;
+        threadNps[i] = (n - beatNodes[i]) * 1000 / (uint64_t)max(elapsed, 1);
+        beatNodes[i] = n;
+    }
+
+    if (!uciQuiet) {
+        mtx_lock(&info->mtx);  // do not interleave with info_print()
+        uci_printf("info time %" PRId64 " nodes %" PRIu64 " nps %" PRIu64 " hashfull %d\n", time,
+            nodes, nodes * 1000 / (uint64_t)max(time, 1), hashfull);
+
+        for (size_t i = 0; i < WorkersCount; i++) {
+            uci_printf("info string thread %zu depth %d nodes %" PRIu64 " nps %" PRIu64, i,
+                Workers[i].depth, Workers[i].nodes, threadNps[i]);
+#ifdef STATS
+            // Pawn hash probes are only counted in the stats build (hot path of the eval)
+            uci_printf(" pawnhit %.1f%%", 100 * ratio(Workers[i].stats.pawnHits,
+                Workers[i].stats.pawnProbes));
+#endif
+            uci_puts("");
+        }
+
+        mtx_unlock(&info->mtx);
+    }
+
+    if (uciMetricsFile[0])
+        write_metrics(threadNps, time, nodes, hashfull);
+}
+
+void info_string(const char *str)
+{
+    if (!uciQuiet)
+        uci_printf("info string %s\n", str);
+}
+
 void info_print_bestmove(Info *info)
 {
+    if (uciQuiet)
+        return;
+
     mtx_lock(&info->mtx);
 
     char best[6];
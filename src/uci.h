@@ -7,6 +7,8 @@ void uci_loop(void);
 typedef struct {
     mtx_t mtx;
     int64_t start;
+    int64_t bestTime;  // time (since start) when the current best move appeared
+    uint64_t bestNodes;  // node count when the current best move appeared
     double variability;
     int lastDepth;
     move_t best, ponder;
@@ -15,13 +17,23 @@ typedef struct {
 extern Info ui;
 extern int64_t uciTimeBuffer;
 extern bool uciChess960;
+extern bool uciQuiet;
 extern size_t uciHash;
+extern int64_t uciHeartbeat;
+extern int uciPonderReplies;
+extern bool uciSharedHistory;
+extern bool uciPrivateHash;
+extern char uciMetricsFile[256];
 
 void info_create(Info *info);
 void info_destroy(Info *info);
 
+void info_seed(Info *info, int depth, const move_t pv[]);
 void info_update(Info *info, int depth, int score, uint64_t nodes, move_t pv[], bool partial);
+void info_heartbeat(Info *info, uint64_t beatNodes[], int64_t elapsed);
+void info_vote(Info *info, int depth, int score, uint64_t nodes, const move_t pv[]);
 void info_print_bestmove(Info *info);
+void info_string(const char *str);
 move_t info_best(Info *info);
 int info_last_depth(Info *info);
 double info_variability(Info *info);
@@ -43,3 +43,14 @@ uint64_t prng(uint64_t *state)
     rnd ^= rnd >> 31;
     return rnd;
 }
+
+double ratio(uint64_t x, uint64_t y)
+{
+    return y ? (double)x / y : 0;
+}
+
+int compare_int64(const void *a, const void *b)
+{
+    const int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
@@ -4,3 +4,6 @@
 
 uint64_t hash(const void *buf, size_t len, uint64_t seed);
 uint64_t prng(uint64_t *state);
+
+double ratio(uint64_t x, uint64_t y);  // x / y, or 0 if y = 0
+int compare_int64(const void *a, const void *b);  // qsort() comparator
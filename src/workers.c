@@ -13,11 +13,14 @@
  * not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdlib.h>
+#include <string.h>
 #include "workers.h"
 #include "search.h"
+#include "uci.h"
 
 Worker *Workers = NULL;
 size_t WorkersCount = 1;
+History SharedHistory;
 
 static void __attribute__((destructor)) workers_free(void)
 {
@@ -26,8 +29,12 @@ static void __attribute__((destructor)) workers_free(void)
 
 void workers_clear()
 {
-    for (size_t i = 0; i < WorkersCount; i++)
+    for (size_t i = 0; i < WorkersCount; i++) {
         Workers[i] = (Worker){0};
+        Workers[i].history = uciSharedHistory ? &SharedHistory : &Workers[i].privateHistory;
+    }
+
+    memset(&SharedHistory, 0, sizeof SharedHistory);
 }
 
 void workers_prepare(size_t count)
@@ -40,8 +47,12 @@ void workers_prepare(size_t count)
 void workers_new_search()
 {
     for (size_t i = 0; i < WorkersCount; i++) {
+        Workers[i].root = rootPos;
         Workers[i].stack = rootStack;
+        Workers[i].alternate = Workers[i].redirect = false;
         Workers[i].nodes = 0;
+        Workers[i].depth = Workers[i].completedDepth = 0;
+        Workers[i].pv[0] = 0;
     }
 }
 
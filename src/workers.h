@@ -1,6 +1,10 @@
 #pragma once
 #include <setjmp.h>
+#include <stdatomic.h>
 #include "bitboard.h"
+#include "htable.h"
+#include "stats.h"
+#include "trace.h"
 #include "zobrist.h"
 #include "search.h"
 
@@ -16,19 +20,42 @@ typedef struct {
     eval_t eval;
 } PawnEntry;
 
+// Move sorting statistics. Accessed with relaxed atomics, because they may be shared by all workers
+// (see uciSharedHistory). On x86, relaxed loads and stores are plain moves: no overhead.
+typedef atomic_int_least16_t history_t;
+
+typedef struct {
+    history_t butterfly[NB_COLOR][NB_SQUARE][NB_SQUARE];
+    history_t refutation[NB_REFUTATION][NB_PIECE][NB_SQUARE];
+    history_t followUp[NB_FOLLOW_UP][NB_PIECE][NB_SQUARE];
+} History;
+
 typedef struct {
+    HashEntry qhash[NB_QHASH];
     PawnEntry pawnHash[NB_PAWN_HASH];
-    int16_t history[NB_COLOR][NB_SQUARE][NB_SQUARE];
-    int16_t refutationHistory[NB_REFUTATION][NB_PIECE][NB_SQUARE];
-    int16_t followUpHistory[NB_FOLLOW_UP][NB_PIECE][NB_SQUARE];
+    History *history;  // &privateHistory, or &SharedHistory
+    History privateHistory;
+    Position root;  // root position searched by this worker (rootPos, except for alternate workers)
     ZobristStack stack;
+    bool alternate;  // pondering an alternative reply: do not report to ui (own thread only)
+    atomic_bool redirect;  // ponderhit: alternate worker must switch to rootPos
     jmp_buf jbuf;
     uint64_t nodes;
+    int depth;  // iteration being searched
+    int completedDepth, bestScore;  // last completed iteration, for SMP voting
+    move_t pv[MAX_PLY + 1];  // PV of the last completed iteration
     int eval[MAX_PLY];
+#ifdef STATS
+    Stats stats;
+#endif
+#ifdef TRACE
+    TraceState trace;
+#endif
 } Worker;
 
 extern Worker *Workers;
 extern size_t WorkersCount;
+extern History SharedHistory;
 
 void workers_clear(void);
 void workers_prepare(size_t count);  // realloc + clear